@@ -0,0 +1,55 @@
+# Expands the delta records of a log written with "probSemSharedMemRestaurant -d" into full state lines,
+# identical to the ones written without -d.
+#
+#   awk -f expand_log.awk logFile
+#   ./probSemSharedMemRestaurant -d | awk -f expand_log.awk | awk -f filter_log.awk -v ngroups=5
+#
+# Each full state line sets the state the following records apply to; every other line is copied as is.
+
+function printState(    g, line) {
+    line = sprintf("%3d%3d%3d ", ch, wt, rc)
+    for(g=0; g<ngroups; g++) {
+        line = line sprintf("%4d", gr[g])
+    }
+    line = line sprintf("%5d", gw)
+    for(g=0; g<ngroups; g++) {
+        line = line sprintf("%4s", tb[g])
+    }
+    print line
+}
+
+# header: one G and one T column per group
+$1 == "CH" && $2 == "WT" {
+    ngroups = (NF-4)/2
+    print
+    next
+}
+
+# full state line
+ngroups > 0 && NF == ngroups*2+4 && $1 ~ /^[0-9]+$/ {
+    ch = $1; wt = $2; rc = $3
+    for(g=0; g<ngroups; g++) {
+        gr[g] = $(g+4)
+        tb[g] = $(g+ngroups+5)
+    }
+    gw = $(ngroups+4)
+    print
+    next
+}
+
+# delta record: @entity state groupsWaiting [Tgroup=table ...]
+$1 ~ /^@/ {
+    if($1 == "@CH") ch = $2
+    else if($1 == "@WT") wt = $2
+    else if($1 == "@RC") rc = $2
+    else gr[substr($1, 3)+0] = $2
+    gw = $3
+    for(i=4; i<=NF; i++) {
+        split(substr($i, 2), t, "=")
+        tb[t[1]+0] = t[2]
+    }
+    printState()
+    next
+}
+
+{ print }
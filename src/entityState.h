@@ -0,0 +1,169 @@
+/**
+ *  \file entityState.h (interface file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  State transitions of the intervening entities.
+ *
+ *  Every change of state of an entity goes through one of the operations below, which update the full state
+ *  of the problem, account for the transition in the shared region (progress counter, histogram of the
+ *  time spent in the previous state and, for the groups, their statistics) and save the new state (or, in delta
+ *  mode, only the change) in the log file:
+ *     \li start of the accounting of the time spent in each state
+ *     \li state change of the chef
+ *     \li state change of the waiter
+ *     \li state change of the receptionist
+ *     \li state change of a group
+ *     \li publication of the tables of the groups and of the number of groups waiting.
+ *
+ *  With <tt>STATELOCKS</tt>, the transitions are queued in the log queue instead (see logging.h), and their
+ *  lines are written once the critical region is left.
+ *
+ *  They must be called inside the critical region (<tt>sh->mutex</tt> held).
+ *  This file relies on the <tt>sh</tt> and <tt>nFic</tt> variables of the entity that includes it, so it must
+ *  be included after their declaration.
+ */
+
+#ifndef ENTITYSTATE_H_
+#define ENTITYSTATE_H_
+
+#include <time.h>
+
+#include "probConst.h"
+#include "logging.h"
+#include "sharedDataSync.h"
+#include "histogram.h"
+
+/** \brief time when the entity entered its present state (in ns) */
+static unsigned long stateSince;
+
+/**
+ *  \brief Reading the monotonic clock (in ns).
+ */
+static unsigned long stateClock (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+/**
+ *  \brief Start of the accounting of the time spent in each state.
+ *
+ *  The entity is considered to be in its initial state from now on.
+ */
+static inline void startStateTime (void)
+{
+    stateSince = stateClock ();
+}
+
+/**
+ *  \brief Accounting of a state transition.
+ *
+ *  The time spent in the previous state is recorded in its histogram, the transition is saved in the log file
+ *  and the progress counter watched by the main process is incremented.
+ *
+ *  \param hist histogram of the previous state
+ *  \param entity entity that changed its state (group id, <tt>LOG_CHEF</tt>, <tt>LOG_WAITER</tt> or
+ *         <tt>LOG_RECEPTIONIST</tt>)
+ *  \param state new state
+ *
+ *  \return time spent in the previous state (in ns)
+ */
+static unsigned long recordTransition (HISTOGRAM *hist, int entity, unsigned int state)
+{
+    unsigned long now = stateClock (),
+                  elapsed = now - stateSince;
+
+    histRecord (hist, elapsed);
+    stateSince = now;
+#ifdef STATELOCKS
+    LOG_RECORD rec = { .entity = entity, .state = state };
+
+    logQueuePut (nFic, &sh->logQueue, &rec);
+#else
+    if (sh->deltaLog)
+        saveStateDelta (nFic, &sh->fSt, entity, sh->loggedTable);
+    else saveState (nFic, &sh->fSt);
+#endif
+    __atomic_fetch_add (&sh->progress, 1, __ATOMIC_RELEASE);
+
+    return elapsed;
+}
+
+/**
+ *  \brief State change of the chef.
+ *
+ *  \param state new state
+ */
+static inline void setChefState (unsigned int state)
+{
+    HISTOGRAM *hist = &sh->chefStateTime[sh->fSt.st.chefStat];
+
+    sh->fSt.st.chefStat = state;
+    recordTransition (hist, LOG_CHEF, state);
+}
+
+/**
+ *  \brief State change of the waiter.
+ *
+ *  \param state new state
+ */
+static inline void setWaiterState (unsigned int state)
+{
+    HISTOGRAM *hist = &sh->waiterStateTime[sh->fSt.st.waiterStat];
+
+    sh->fSt.st.waiterStat = state;
+    recordTransition (hist, LOG_WAITER, state);
+}
+
+/**
+ *  \brief State change of the receptionist.
+ *
+ *  \param state new state
+ */
+static inline void setReceptionistState (unsigned int state)
+{
+    HISTOGRAM *hist = &sh->receptionistStateTime[sh->fSt.st.receptionistStat];
+
+    sh->fSt.st.receptionistStat = state;
+    recordTransition (hist, LOG_RECEPTIONIST, state);
+}
+
+/**
+ *  \brief State change of a group.
+ *
+ *  The statistics of the group are updated as well.
+ *
+ *  \param id group id
+ *  \param state new state
+ */
+static inline void setGroupState (int id, unsigned int state)
+{
+    unsigned int prev = GROUPSTAT (sh->fSt.st, id);
+
+    GROUPSTAT (sh->fSt.st, id) = state;
+    sh->groupStats.stateTime[id][prev] += recordTransition (&sh->groupStateTime[prev], id, state);
+    __atomic_store_n (&sh->groupStats.since[id], stateSince, __ATOMIC_RELAXED);
+}
+
+/**
+ *  \brief Publication of the tables of the groups and of the number of groups waiting.
+ *
+ *  They are changed by the receptionist only. Without <tt>STATELOCKS</tt>, they are saved with the next state
+ *  line; with it, they are queued in the log queue so that the next line of the log holds them.
+ */
+static inline void publishTables (void)
+{
+#ifdef STATELOCKS
+    LOG_RECORD rec = { .entity = LOG_TABLES, .groupsWaiting = sh->fSt.groupsWaiting };
+    int g;
+
+    for (g = 0; g < sh->fSt.nGroups; g++)
+        rec.table[g] = GROUPTABLE (sh->fSt, g);
+    logQueuePut (nFic, &sh->logQueue, &rec);
+#endif
+}
+
+#endif /* ENTITYSTATE_H_ */
@@ -0,0 +1,153 @@
+/**
+ *  \file histogram.c (implementation file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  \brief Log-bucketed latency histograms, updated lock-free by several processes.
+ *
+ *  Defined operations:
+ *     \li recording a value
+ *     \li computing a percentile
+ *     \li printing a summary line
+ *     \li printing the buckets in CSV format.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "histogram.h"
+
+/** \brief number of sub-buckets of each power of two */
+#define  SUBBUCKETS        (1UL << HIST_SUBBITS)
+
+/* internal functions */
+
+static unsigned int bucketOf (unsigned long value)
+{
+    unsigned int msb;
+
+    if (value < SUBBUCKETS)
+        return (unsigned int) value;
+
+    msb = 63 - __builtin_clzl (value);
+    if (msb >= HIST_MAXBITS)
+        return HIST_BUCKETS - 1;
+
+    return ((msb - HIST_SUBBITS + 1) << HIST_SUBBITS) + ((value >> (msb - HIST_SUBBITS)) & (SUBBUCKETS - 1));
+}
+
+static unsigned long lowestOf (unsigned int b)
+{
+    unsigned int shift;
+
+    if (b < SUBBUCKETS)
+        return b;
+
+    shift = (b >> HIST_SUBBITS) - 1;
+    return (SUBBUCKETS + (b & (SUBBUCKETS - 1))) << shift;
+}
+
+static unsigned long highestOf (unsigned int b)
+{
+    if (b < SUBBUCKETS)
+        return b;
+
+    return lowestOf (b) + (1UL << ((b >> HIST_SUBBITS) - 1)) - 1;
+}
+
+/* external functions */
+
+/**
+ *  \brief Recording a value.
+ *
+ *  \param h pointer to the histogram
+ *  \param value value to be recorded
+ */
+void histRecord (HISTOGRAM *h, unsigned long value)
+{
+    unsigned long max = __atomic_load_n (&h->max, __ATOMIC_RELAXED);
+
+    __atomic_fetch_add (&h->bucket[bucketOf (value)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add (&h->sum, value, __ATOMIC_RELAXED);
+    __atomic_fetch_add (&h->count, 1, __ATOMIC_RELAXED);
+    while ((value > max) &&
+           !__atomic_compare_exchange_n (&h->max, &max, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+/**
+ *  \brief Computing a percentile.
+ *
+ *  \param h pointer to the histogram
+ *  \param p percentile (0 .. 100)
+ *
+ *  \return highest value equivalent to the percentile (0 if the histogram is empty)
+ */
+unsigned long histPercentile (const HISTOGRAM *h, double p)
+{
+    unsigned long total = 0, rank, seen = 0;
+    unsigned int b;
+
+    for (b = 0; b < HIST_BUCKETS; b++)
+        total += h->bucket[b];
+    if (total == 0)
+        return 0;
+
+    rank = (unsigned long) (p / 100.0 * total + 0.5);
+    if (rank < 1)
+        rank = 1;
+    for (b = 0; b < HIST_BUCKETS; b++)
+        if ((seen += h->bucket[b]) >= rank)
+            break;
+
+    return (highestOf (b) < h->max) ? highestOf (b) : h->max;
+}
+
+/**
+ *  \brief Printing the header of the summary lines.
+ *
+ *  \param fic output stream
+ */
+void histPrintHeader (FILE *fic)
+{
+    fprintf (fic, "%-26s %8s %10s %10s %10s %10s %10s %10s\n",
+             "(ms)", "count", "mean", "p50", "p90", "p99", "p99.9", "max");
+}
+
+/**
+ *  \brief Printing a summary line: count, mean, p50, p90, p99, p99.9 and maximum, in milliseconds.
+ *
+ *  Empty histograms are not printed.
+ *
+ *  \param fic output stream
+ *  \param name name of the histogram
+ *  \param h pointer to the histogram
+ */
+void histPrint (FILE *fic, const char *name, const HISTOGRAM *h)
+{
+    if (h->count == 0)
+        return;
+
+    fprintf (fic, "%-26s %8lu %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n", name, h->count,
+             (double) h->sum / h->count / 1e6,
+             histPercentile (h, 50.0) / 1e6, histPercentile (h, 90.0) / 1e6,
+             histPercentile (h, 99.0) / 1e6, histPercentile (h, 99.9) / 1e6, h->max / 1e6);
+}
+
+/**
+ *  \brief Printing the non-empty buckets in CSV format.
+ *
+ *  Each line holds the name of the histogram, the bounds of the bucket (in nanoseconds) and its count.
+ *
+ *  \param fic output stream
+ *  \param name name of the histogram
+ *  \param h pointer to the histogram
+ */
+void histPrintCsv (FILE *fic, const char *name, const HISTOGRAM *h)
+{
+    unsigned int b;
+
+    for (b = 0; b < HIST_BUCKETS; b++)
+        if (h->bucket[b] != 0)
+            fprintf (fic, "%s,%lu,%lu,%lu\n", name, lowestOf (b), highestOf (b), h->bucket[b]);
+}
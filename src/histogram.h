@@ -0,0 +1,93 @@
+/**
+ *  \file histogram.h (interface file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  \brief Log-bucketed latency histograms, updated lock-free by several processes.
+ *
+ *  Values (times in nanoseconds) are counted in buckets whose width doubles at every power of two, each power
+ *  of two being split into <tt>2^HIST_SUBBITS</tt> sub-buckets, so that every value is known within a relative
+ *  error below <tt>2^-HIST_SUBBITS</tt> (HDR histogram style). A histogram has a fixed size and can live in
+ *  shared memory: it is updated with atomic operations only.
+ *
+ *  Defined operations:
+ *     \li recording a value
+ *     \li computing a percentile
+ *     \li printing a summary line
+ *     \li printing the buckets in CSV format.
+ */
+
+#ifndef HISTOGRAM_H_
+#define HISTOGRAM_H_
+
+#include <stdio.h>
+
+/** \brief bits of precision of each bucket */
+#define  HIST_SUBBITS         5
+/** \brief values are counted up to 2^HIST_MAXBITS (larger values go to the last bucket) */
+#define  HIST_MAXBITS        44
+/** \brief number of buckets */
+#define  HIST_BUCKETS        ((HIST_MAXBITS - HIST_SUBBITS + 1) << HIST_SUBBITS)
+
+/**
+ *  \brief Definition of the histogram data type.
+ */
+typedef struct {
+    /** \brief number of recorded values */
+    unsigned long count;
+    /** \brief sum of the recorded values */
+    unsigned long sum;
+    /** \brief largest recorded value */
+    unsigned long max;
+    /** \brief number of values in each bucket */
+    unsigned long bucket[HIST_BUCKETS];
+} HISTOGRAM;
+
+/**
+ *  \brief Recording a value.
+ *
+ *  \param h pointer to the histogram
+ *  \param value value to be recorded
+ */
+extern void histRecord (HISTOGRAM *h, unsigned long value);
+
+/**
+ *  \brief Computing a percentile.
+ *
+ *  \param h pointer to the histogram
+ *  \param p percentile (0 .. 100)
+ *
+ *  \return highest value equivalent to the percentile (0 if the histogram is empty)
+ */
+extern unsigned long histPercentile (const HISTOGRAM *h, double p);
+
+/**
+ *  \brief Printing the header of the summary lines.
+ *
+ *  \param fic output stream
+ */
+extern void histPrintHeader (FILE *fic);
+
+/**
+ *  \brief Printing a summary line: count, mean, p50, p90, p99, p99.9 and maximum, in milliseconds.
+ *
+ *  Empty histograms are not printed.
+ *
+ *  \param fic output stream
+ *  \param name name of the histogram
+ *  \param h pointer to the histogram
+ */
+extern void histPrint (FILE *fic, const char *name, const HISTOGRAM *h);
+
+/**
+ *  \brief Printing the non-empty buckets in CSV format.
+ *
+ *  Each line holds the name of the histogram, the bounds of the bucket (in nanoseconds) and its count.
+ *
+ *  \param fic output stream
+ *  \param name name of the histogram
+ *  \param h pointer to the histogram
+ */
+extern void histPrintCsv (FILE *fic, const char *name, const HISTOGRAM *h);
+
+#endif /* HISTOGRAM_H_ */
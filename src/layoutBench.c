@@ -0,0 +1,174 @@
+/**
+ *  \file layoutBench.c (implementation file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  Benchmark of the layout of the full state of the problem.
+ *
+ *  One process per intervening entity repeatedly changes the fields it owns in a shared <tt>FULL_STAT</tt>
+ *  (its state word and, for the receptionist and the waiter, the fields they update) and reads the
+ *  configuration of the problem, as the entities do, but with no synchronization at all. The elapsed time
+ *  thus measures the cost of the cache lines bouncing between the processors: it should be much smaller when
+ *  the benchmark is compiled with <tt>ALIGNEDLAYOUT</tt>. With <tt>PACKEDSTAT</tt> the state of all the entities
+ *  fits in fewer cache lines, which makes the snapshots cheaper but the false sharing worse (<tt>make bench</tt>
+ *  builds the three versions).
+ *
+ *  Upon execution, the following parameters are accepted:
+ *    \li <tt>-g groups</tt>: number of group processes (optional, 5 by default)
+ *    \li <tt>-n iterations</tt>: number of changes made by each process (optional, 10000000 by default).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "sharedMemory.h"
+
+/** \brief default number of group processes */
+#define  GROUPS               5
+
+/** \brief default number of changes made by each process */
+#define  ITERATIONS    10000000L
+
+/** \brief identification of the chef process */
+#define  CHEF                -1
+/** \brief identification of the waiter process */
+#define  WAITER              -2
+/** \brief identification of the receptionist process */
+#define  RECEPTIONIST        -3
+
+/**
+ *  \brief Changes made by an entity.
+ *
+ *  \param fSt pointer to the shared full state
+ *  \param id group id, or <tt>CHEF</tt>, <tt>WAITER</tt> or <tt>RECEPTIONIST</tt>
+ *  \param iterations number of changes
+ *
+ *  \return sum of the configuration values read (so that the reads are not optimized away)
+ */
+static long work (FULL_STAT *fSt, int id, long iterations)
+{
+    long i, sum = 0;
+
+    for (i = 0; i < iterations; i++) {
+        switch (id) {
+            case CHEF:
+                __atomic_store_n (&fSt->st.chefStat, (STATE_WORD) (i & 3), __ATOMIC_RELAXED);
+                break;
+            case WAITER:
+                __atomic_store_n (&fSt->st.waiterStat, (STATE_WORD) (i & 3), __ATOMIC_RELAXED);
+                __atomic_store_n (&fSt->foodOrder, (int) i & 1, __ATOMIC_RELAXED);
+                break;
+            case RECEPTIONIST:
+                __atomic_store_n (&fSt->st.receptionistStat, (STATE_WORD) (i & 3), __ATOMIC_RELAXED);
+                __atomic_store_n (&fSt->groupsWaiting, (int) i & 7, __ATOMIC_RELAXED);
+                break;
+            default:
+                __atomic_store_n (&GROUPSTAT (fSt->st, id), (STATE_WORD) (i & 7), __ATOMIC_RELAXED);
+                sum += __atomic_load_n (&GROUPEAT (*fSt, id), __ATOMIC_RELAXED);
+        }
+        sum += __atomic_load_n (&fSt->nGroups, __ATOMIC_RELAXED);
+    }
+
+    return sum;
+}
+
+/**
+ *  \brief Main program.
+ *
+ *  Its role is to run the entities processes on a shared full state and to report the elapsed time.
+ */
+int main (int argc, char *argv[])
+{
+    int shmid, opt, nGroups = GROUPS, id, nProc = 0;
+    long iterations = ITERATIONS;
+    char *tinp;
+    FULL_STAT *fSt;
+    struct timespec start, end;
+    double elapsed;
+
+    while ((opt = getopt (argc, argv, "g:n:")) != -1) {
+        switch (opt) {
+            case 'g':
+                nGroups = (int) strtol (optarg, &tinp, 0);
+                if ((*tinp != '\0') || (nGroups < 1) || (nGroups > MAXGROUPS)) {
+                    fprintf (stderr, "Number of groups must be between 1 and %d!\n", MAXGROUPS);
+                    exit (EXIT_FAILURE);
+                }
+                break;
+            case 'n':
+                iterations = strtol (optarg, &tinp, 0);
+                if ((*tinp != '\0') || (iterations < 1)) {
+                    fprintf (stderr, "Number of iterations must be positive!\n");
+                    exit (EXIT_FAILURE);
+                }
+                break;
+            default:
+                fprintf (stderr, "Usage: %s [-g groups] [-n iterations]\n", argv[0]);
+                exit (EXIT_FAILURE);
+        }
+    }
+
+    if ((shmid = shmemCreate (IPC_PRIVATE, sizeof (FULL_STAT))) == -1) {
+        perror ("error on creating the shared memory region");
+        exit (EXIT_FAILURE);
+    }
+    if (shmemAttach (shmid, (void **) &fSt) == -1) {
+        perror ("error on mapping the shared region on the process address space");
+        exit (EXIT_FAILURE);
+    }
+    /* the region is destroyed as soon as every process has unmapped it */
+    shmemDestroy (shmid);
+    fSt->nGroups = nGroups;
+
+#ifdef ALIGNEDLAYOUT
+    printf ("layout: aligned to %d-byte cache lines\n", CACHELINE);
+#else
+    printf ("layout: unpadded\n");
+#endif
+#ifdef GROUPBLOCKS
+    printf ("groups: hot and cold blocks\n");
+#endif
+    printf ("states: %zu-bit, table ids: %zu-bit\n", 8 * sizeof (STATE_WORD), 8 * sizeof (TABLE_ID));
+    printf ("sizeof (STAT) = %zu, sizeof (FULL_STAT) = %zu, chefStat @%zu, groupStat @%zu, nGroups @%zu, "
+            "groupsWaiting @%zu, foodOrder @%zu\n", sizeof (STAT), sizeof (FULL_STAT), offsetof (FULL_STAT, st.chefStat),
+#ifdef GROUPBLOCKS
+            offsetof (FULL_STAT, st.group.stat), offsetof (FULL_STAT, nGroups),
+#else
+            offsetof (FULL_STAT, st.groupStat), offsetof (FULL_STAT, nGroups),
+#endif
+            offsetof (FULL_STAT, groupsWaiting), offsetof (FULL_STAT, foodOrder));
+
+    fflush (stdout);
+
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    for (id = RECEPTIONIST; id < nGroups; id++) {
+        switch (fork ()) {
+            case -1:
+                perror ("error on the generation of a process");
+                exit (EXIT_FAILURE);
+            case 0:
+                exit ((work (fSt, id, iterations) == 0) ? EXIT_FAILURE : EXIT_SUCCESS);
+            default:
+                nProc += 1;
+        }
+    }
+    while (wait (NULL) != -1)
+        ;
+    clock_gettime (CLOCK_MONOTONIC, &end);
+
+    elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf ("%d processes x %ld changes: %.3f s (%.2f ns per iteration, %ld online processors)\n",
+            nProc, iterations, elapsed, elapsed * 1e9 / iterations, sysconf (_SC_NPROCESSORS_ONLN));
+
+    shmemDettach (fSt);
+
+    return EXIT_SUCCESS;
+}
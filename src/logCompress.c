@@ -0,0 +1,128 @@
+/**
+ *  \file logCompress.c (implementation file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  \brief Compression of the logging file.
+ *
+ *  The intervening entities append their lines to a memory mapped spool file (see logging.h); a single writer,
+ *  the main process, periodically drains the lines completely written since the previous call into a gzip
+ *  stream, releasing the storage of the spool as it goes.
+ *
+ *  Defined operations:
+ *     \li opening of the compressed file
+ *     \li draining of the spool file into the compressed file
+ *     \li closing of the compressed file.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <zlib.h>
+
+#include "logging.h"
+#include "logCompress.h"
+
+/** \brief size of the blocks read from the spool file (in bytes) */
+#define  DRAINBLOCK      (64 * 1024)
+
+/** \brief name of the spool file */
+static char spoolName[256];
+
+/** \brief descriptor of the spool file */
+static int spoolFd = -1;
+
+/** \brief compressed file */
+static gzFile gz = NULL;
+
+/** \brief length of the spool file already compressed (in bytes) */
+static unsigned long drained = 0;
+
+/** \brief length of the spool file whose storage was released (in bytes) */
+static unsigned long released = 0;
+
+/**
+ *  \brief Opening of the compressed file.
+ *
+ *  \param nFicSpool name of the spool file, which must hold the header of the log
+ *  \param nFicGz name of the compressed file
+ */
+void logCompressOpen (char nFicSpool[], char nFicGz[])
+{
+    if (strlen (nFicSpool) >= sizeof (spoolName)) {
+        fprintf (stderr, "Spool file name is too long!\n");
+        exit (EXIT_FAILURE);
+    }
+    strcpy (spoolName, nFicSpool);
+    if ((spoolFd = open (nFicSpool, O_RDWR)) == -1) {
+        perror ("error on opening the spool file");
+        exit (EXIT_FAILURE);
+    }
+    if ((gz = gzopen (nFicGz, "wb")) == NULL) {
+        perror ("error on opening the compressed log file");
+        exit (EXIT_FAILURE);
+    }
+    drained = released = 0;
+}
+
+/**
+ *  \brief Draining of the spool file into the compressed file.
+ *
+ *  The lines completely written since the previous call are compressed and their storage in the spool file
+ *  is released.
+ *
+ *  \param cursor write cursor of the spool file, in the shared region
+ */
+void logCompressDrain (LOG_CURSOR *cursor)
+{
+    static char buf[DRAINBLOCK];
+    unsigned long end = __atomic_load_n (&cursor->committed, __ATOMIC_ACQUIRE);
+    long page = sysconf (_SC_PAGESIZE);
+    ssize_t n;
+
+    while (drained < end) {
+        n = pread (spoolFd, buf, (end - drained < DRAINBLOCK) ? end - drained : DRAINBLOCK, (off_t) drained);
+        if (n <= 0) {
+            perror ("error on reading the spool file");
+            exit (EXIT_FAILURE);
+        }
+        if (gzwrite (gz, buf, (unsigned int) n) != n) {
+            fprintf (stderr, "error on writing the compressed log file\n");
+            exit (EXIT_FAILURE);
+        }
+        drained += n;
+    }
+
+    /* the whole pages already compressed are no longer needed (the file keeps its size) */
+    end = drained / page * page;
+    if (end > released) {
+        fallocate (spoolFd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, (off_t) released, (off_t) (end - released));
+        released = end;
+    }
+}
+
+/**
+ *  \brief Closing of the compressed file.
+ *
+ *  The remaining lines are drained, the gzip stream is finished and the spool file is removed. It must be
+ *  called once all the intervening entities have terminated.
+ *
+ *  \param cursor write cursor of the spool file, in the shared region
+ */
+void logCompressClose (LOG_CURSOR *cursor)
+{
+    logCompressDrain (cursor);
+    if (gzclose (gz) != Z_OK) {
+        fprintf (stderr, "error on closing the compressed log file\n");
+        exit (EXIT_FAILURE);
+    }
+    gz = NULL;
+    close (spoolFd);
+    spoolFd = -1;
+    if (unlink (spoolName) == -1)
+        perror ("error on removing the spool file");
+}
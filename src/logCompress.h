@@ -0,0 +1,52 @@
+/**
+ *  \file logCompress.h (interface file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  \brief Compression of the logging file.
+ *
+ *  The intervening entities append their lines to a memory mapped spool file (see logging.h); a single writer,
+ *  the main process, periodically drains the lines completely written since the previous call into a gzip
+ *  stream, releasing the storage of the spool as it goes. The compressed file is read by <tt>zcat</tt>, so
+ *  <tt>zcat logFile | awk -f filter_log.awk -v ngroups=N</tt> (or <tt>expand_log.awk</tt>) still applies.
+ *
+ *  Defined operations:
+ *     \li opening of the compressed file
+ *     \li draining of the spool file into the compressed file
+ *     \li closing of the compressed file.
+ */
+
+#ifndef LOGCOMPRESS_H_
+#define LOGCOMPRESS_H_
+
+#include "logging.h"
+
+/**
+ *  \brief Opening of the compressed file.
+ *
+ *  \param nFicSpool name of the spool file, which must hold the header of the log
+ *  \param nFicGz name of the compressed file
+ */
+extern void logCompressOpen (char nFicSpool[], char nFicGz[]);
+
+/**
+ *  \brief Draining of the spool file into the compressed file.
+ *
+ *  The lines completely written since the previous call are compressed and their storage in the spool file
+ *  is released.
+ *
+ *  \param cursor write cursor of the spool file, in the shared region
+ */
+extern void logCompressDrain (LOG_CURSOR *cursor);
+
+/**
+ *  \brief Closing of the compressed file.
+ *
+ *  The remaining lines are drained, the gzip stream is finished and the spool file is removed. It must be
+ *  called once all the intervening entities have terminated.
+ *
+ *  \param cursor write cursor of the spool file, in the shared region
+ */
+extern void logCompressClose (LOG_CURSOR *cursor);
+
+#endif /* LOGCOMPRESS_H_ */
@@ -7,7 +7,15 @@
  *
  *  Defined operations:
  *     \li file initialization
- *     \li writing the present full state as a single line at the end of the file.
+ *     \li writing the present full state as a single line at the end of the file
+ *     \li size of the file
+ *     \li writing the change made by a state transition as a single line at the end of the file
+ *     \li creation, opening and closing of a memory mapped logging file
+ *     \li opening of a shard of the logging file
+ *     \li initialization of a log queue, queuing of a state transition and writing of the transitions queued
+ *     \li opening of the record file of the receptionist
+ *     \li writing the wait predicted for a group as a single line of the record file
+ *     \li writing a request served by the receptionist as a single line of the record file.
  *
  *  \author Nuno Lau - December 2023
  */
@@ -18,11 +26,47 @@
 #include <stdbool.h>
 
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
-
+#include <errno.h>
+#include <sys/mman.h>
+#include <sched.h>
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
 
 #include "probConst.h"
 #include "probDataStruct.h"
+#include "trace.h"
+#include "logging.h"
+
+/** \brief maximum size of a line holding a full state */
+#define  LINESIZE        256
+
+/** \brief size of the chunks by which a memory mapped logging file grows (in bytes) */
+#define  LOGCHUNK        (4UL << 20)
+
+/** \brief write cursor (in the shared region) of the memory mapped logging file, if it is used */
+static LOG_CURSOR *mapCursor = NULL;
+
+/** \brief descriptor of the memory mapped logging file */
+static int mapFd = -1;
+
+/** \brief mapping of the logging file onto the process address space */
+static char *mapAdd = NULL;
+
+/** \brief size of the mapping (in bytes) */
+static unsigned long mapSize = 0;
+
+/** \brief shard of the logging file written by the process, if it is used */
+static FILE *shardFic = NULL;
+
+/** \brief global sequence counter (in the shared region) of the lines of the shards */
+static unsigned long *shardSeq = NULL;
+
+/** \brief record file of the receptionist, if it is used */
+static FILE *recFic = NULL;
 
 /* internal functions */
 
@@ -80,6 +124,223 @@ static void printHeader(FILE *fic, FULL_STAT *p_fSt)
     fprintf(fic,"\n");
 }
 
+/* makes the mapping cover at least size bytes, growing the file by whole chunks if needed */
+static void growMap(unsigned long size)
+{
+    struct stat st;
+    int err;
+
+    size = (size + LOGCHUNK - 1) / LOGCHUNK * LOGCHUNK;
+    if (fstat(mapFd, &st) == -1) {
+        perror ("error on reading the size of the log file");
+        exit (EXIT_FAILURE);
+    }
+    /* several processes may grow the file at the same time: it never shrinks */
+    if ((unsigned long) st.st_size < size) {
+        if ((err = posix_fallocate(mapFd, 0, size)) != 0) {
+            /* the file system does not preallocate: holes are filled when the pages are written */
+            if ((err != EOPNOTSUPP) || (ftruncate(mapFd, size) == -1)) {
+                errno = err;
+                perror ("error on growing the log file");
+                exit (EXIT_FAILURE);
+            }
+        }
+    }
+    if ((mapAdd != NULL) && (munmap(mapAdd, mapSize) == -1)) {
+        perror ("error on unmapping the log file");
+        exit (EXIT_FAILURE);
+    }
+    if ((mapAdd = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, mapFd, 0)) == MAP_FAILED) {
+        perror ("error on mapping the log file");
+        exit (EXIT_FAILURE);
+    }
+    mapSize = size;
+}
+
+/* appends a line to the memory mapped logging file */
+static void appendMapped(char *line, int len)
+{
+    unsigned long off = __atomic_fetch_add(&mapCursor->reserved, (unsigned long) len, __ATOMIC_RELAXED);
+
+    if (off + len > mapSize)
+        growMap(off + len);
+    memcpy(mapAdd + off, line, len);
+    __atomic_store_n(&mapCursor->committed, off + len, __ATOMIC_RELEASE);
+}
+
+/* appends a line to the logging file, its memory mapping or the shard of the process */
+static void writeLine(char nFic[], char *line, int len)
+{
+    FILE *fic;
+
+    if (shardFic != NULL) {
+        /* the sequence number is taken inside the critical region, so it sets the global order */
+        fprintf(shardFic, "%lu ", __atomic_fetch_add(shardSeq, 1, __ATOMIC_RELAXED));
+        fwrite(line, 1, len, shardFic);
+    }
+    else if (mapCursor != NULL)
+        appendMapped(line, len);
+    else {
+        fic = openLog(nFic,"a");
+        fwrite(line, 1, len, fic);
+        closeLog(fic);
+    }
+}
+
+/*
+ * Fast formatting of the state lines.
+ *
+ * Almost every value of a state line is a single digit (states, table ids), so its column is three blanks
+ * followed by the digit: a 32-bit word 0x30202020 + (d << 24) in little-endian order. The columns of the
+ * group states and tables are built with SSE2 (4 groups at a time) or AVX2 (8 groups at a time) when the
+ * compiler targets them, and one at a time otherwise; any value that is not a single digit is formatted by
+ * snprintf, so the output is byte-identical to the "%3d%3d%3d %4d...%5d%4d..." layout in every case.
+ */
+
+#if defined (__SSE2__) && (!defined (ALIGNEDLAYOUT) || defined (GROUPBLOCKS))
+/* the group states are contiguous */
+#define  STATEVECTOR
+#endif
+
+/** \brief column of a single digit */
+#define  DIGITCOL        0x30202020
+/** \brief column of a table that is not assigned */
+#define  NOTABLECOL      0x2E202020
+
+/* writes v right-aligned in width columns; returns the number of characters it takes */
+static int putNumber(char *p, size_t size, int width, int v)
+{
+    if ((v >= 0) && (v <= 9) && (size > (size_t) width)) {
+        memset(p, ' ', width - 1);
+        p[width-1] = '0' + v;
+        return width;
+    }
+    return snprintf(p, size, "%*d", width, v);
+}
+
+/* writes the 4-column group states; returns the number of groups done */
+static int putStates(char *p, size_t size, STAT *st, int n)
+{
+    int g = 0;
+
+#ifdef STATEVECTOR
+    const STATE_WORD *v = &GROUPSTAT(*st, 0);
+#ifdef __AVX2__
+    const __m256i col8 = _mm256_set1_epi32(DIGITCOL), nine8 = _mm256_set1_epi32(9);
+
+    for (; (g + 8 <= n) && (4 * (size_t) g + 32 <= size); g += 8) {
+#ifdef PACKEDSTAT
+        __m256i x = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (v + g)));
+#else
+        __m256i x = _mm256_loadu_si256((const __m256i *) (v + g));
+#endif
+        /* x <= 9 (unsigned) */
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_min_epu32(x, nine8), x)) != -1)
+            break;
+        _mm256_storeu_si256((__m256i *) (p + 4*g), _mm256_add_epi32(_mm256_slli_epi32(x, 24), col8));
+    }
+#endif
+    const __m128i col = _mm_set1_epi32(DIGITCOL), ten = _mm_set1_epi32(10);
+
+    for (; (g + 4 <= n) && (4 * (size_t) g + 16 <= size); g += 4) {
+#ifdef PACKEDSTAT
+        int32_t b;
+        memcpy(&b, v + g, sizeof(b));
+        __m128i x = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(b), _mm_setzero_si128()),
+                                       _mm_setzero_si128());
+#else
+        __m128i x = _mm_loadu_si128((const __m128i *) (v + g));
+#endif
+        /* 0 <= x < 10 as signed integers is the same as x < 10 unsigned */
+        if (_mm_movemask_epi8(_mm_and_si128(_mm_cmplt_epi32(x, ten), _mm_cmpgt_epi32(x, _mm_set1_epi32(-1))))
+            != 0xFFFF)
+            break;
+        _mm_storeu_si128((__m128i *) (p + 4*g), _mm_add_epi32(_mm_slli_epi32(x, 24), col));
+    }
+#endif
+    return g;
+}
+
+/* writes the 4-column group tables; returns the number of groups done */
+static int putTables(char *p, size_t size, FULL_STAT *p_fSt, int n)
+{
+    int g = 0;
+
+#ifdef __SSE2__
+    const TABLE_ID *v = &GROUPTABLE(*p_fSt, 0);
+#ifdef __AVX2__
+    const __m256i col8 = _mm256_set1_epi32(DIGITCOL), dot8 = _mm256_set1_epi32(NOTABLECOL),
+                  ten8 = _mm256_set1_epi32(10), none8 = _mm256_set1_epi32(-1);
+
+    for (; (g + 8 <= n) && (4 * (size_t) g + 32 <= size); g += 8) {
+#ifdef PACKEDSTAT
+        __m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (v + g)));
+#else
+        __m256i x = _mm256_loadu_si256((const __m256i *) (v + g));
+#endif
+        __m256i none = _mm256_cmpeq_epi32(x, none8);
+        /* -1 <= x < 10 */
+        if (_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpgt_epi32(ten8, x),
+                                                  _mm256_cmpgt_epi32(x, _mm256_set1_epi32(-2)))) != -1)
+            break;
+        _mm256_storeu_si256((__m256i *) (p + 4*g),
+                            _mm256_blendv_epi8(_mm256_add_epi32(_mm256_slli_epi32(x, 24), col8), dot8, none));
+    }
+#endif
+    const __m128i col = _mm_set1_epi32(DIGITCOL), dot = _mm_set1_epi32(NOTABLECOL),
+                  ten = _mm_set1_epi32(10), none1 = _mm_set1_epi32(-1);
+
+    for (; (g + 4 <= n) && (4 * (size_t) g + 16 <= size); g += 4) {
+#ifdef PACKEDSTAT
+        __m128i x = _mm_loadl_epi64((const __m128i *) (v + g));
+        x = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+#else
+        __m128i x = _mm_loadu_si128((const __m128i *) (v + g));
+#endif
+        __m128i none = _mm_cmpeq_epi32(x, none1);
+        /* -1 <= x < 10 */
+        if (_mm_movemask_epi8(_mm_and_si128(_mm_cmplt_epi32(x, ten), _mm_cmpgt_epi32(x, _mm_set1_epi32(-2))))
+            != 0xFFFF)
+            break;
+        x = _mm_add_epi32(_mm_slli_epi32(x, 24), col);
+        _mm_storeu_si128((__m128i *) (p + 4*g), _mm_or_si128(_mm_and_si128(none, dot), _mm_andnot_si128(none, x)));
+    }
+#endif
+    return g;
+}
+
+static int formatState(char *line, size_t size, FULL_STAT *p_fSt)
+{
+    int len = 0, g;
+
+    len += putNumber(line+len, size-len, 3, p_fSt->st.chefStat);
+    len += putNumber(line+len, size-len, 3, p_fSt->st.waiterStat);
+    len += putNumber(line+len, size-len, 3, p_fSt->st.receptionistStat);
+    len += snprintf(line+len, size-len, " ");
+
+    g = putStates(line+len, size-len, &p_fSt->st, p_fSt->nGroups);
+    len += 4 * g;
+    for(; g < p_fSt->nGroups; g++) {
+        len += putNumber(line+len, size-len, 4, GROUPSTAT(p_fSt->st, g));
+    }
+
+    len += putNumber(line+len, size-len, 5, p_fSt->groupsWaiting);
+
+    g = putTables(line+len, size-len, p_fSt, p_fSt->nGroups);
+    len += 4 * g;
+    for(; g < p_fSt->nGroups; g++) {
+        if(GROUPTABLE(*p_fSt, g)!=-1)
+            len += putNumber(line+len, size-len, 4, GROUPTABLE(*p_fSt, g));
+        else {
+            len += snprintf(line+len, size-len, "%4s", ".");
+        }
+    }
+
+    len += snprintf(line+len, size-len, "\n");
+
+    return len;
+}
+
 /* external functions */
 
 /**
@@ -125,32 +386,321 @@ void createLog (char nFic[], FULL_STAT *p_fSt)
  */
 void saveState (char nFic[], FULL_STAT *p_fSt)
 {
-    FILE *fic;                                                                                      /* file descriptor */
+    char line[LINESIZE];                                                                         /* formatted line */
 
-    fic = openLog(nFic,"a");
+    traceBegin ("log", "saveState");
+    writeLine(nFic, line, formatState(line, sizeof(line), p_fSt));
+    traceEnd ("log", "saveState");
+}
 
-    fprintf(fic,"%3d",p_fSt->st.chefStat);
-    fprintf(fic,"%3d",p_fSt->st.waiterStat);
-    fprintf(fic,"%3d",p_fSt->st.receptionistStat);
-    fprintf(fic," ");
-    int g;
-    for(g=0; g < p_fSt->nGroups; g++) {
-        fprintf(fic,"%4d",p_fSt->st.groupStat[g]);
+/**
+ *  \brief Size of the logging file.
+ *
+ *  \param nFic name of the logging file
+ *
+ *  \return size of the file (in bytes), or -\c 1 if stdout is used
+ */
+long logSize (char nFic[])
+{
+    struct stat st;
+
+    if ((nFic == NULL) || (strlen (nFic) == 0))
+        return -1;
+
+    if (stat (nFic, &st) == -1) {
+        perror ("error on reading the size of the log file");
+        exit (EXIT_FAILURE);
     }
+    return (long) st.st_size;
+}
+
+/**
+ *  \brief Writing the change made by a state transition as a single line at the end of the file.
+ *
+ *  If <tt>nFic</tt> is a null pointer or a null string, the lines are written to stdout.
+ *
+ *  The line holds the entity that changed its state, its new state, the number of groups waiting for a table
+ *  and the groups whose table changed since the previous line (see logging.h).
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *  \param entity group id, or <tt>LOG_CHEF</tt>, <tt>LOG_WAITER</tt> or <tt>LOG_RECEPTIONIST</tt>
+ *  \param lastTable table of each group in the previous line of the file (updated)
+ */
+void saveStateDelta (char nFic[], FULL_STAT *p_fSt, int entity, TABLE_ID lastTable[])
+{
+    char line[LINESIZE];                                                                         /* formatted line */
+    int len, g;
 
-    fprintf(fic,"%5d",p_fSt->groupsWaiting);
+    traceBegin ("log", "saveStateDelta");
+    switch (entity) {
+        case LOG_CHEF:
+            len = snprintf(line, sizeof(line), "@CH %d", p_fSt->st.chefStat);
+            break;
+        case LOG_WAITER:
+            len = snprintf(line, sizeof(line), "@WT %d", p_fSt->st.waiterStat);
+            break;
+        case LOG_RECEPTIONIST:
+            len = snprintf(line, sizeof(line), "@RC %d", p_fSt->st.receptionistStat);
+            break;
+        default:
+            len = snprintf(line, sizeof(line), "@G%d %d", entity, GROUPSTAT(p_fSt->st, entity));
+    }
+    len += snprintf(line+len, sizeof(line)-len, " %d", p_fSt->groupsWaiting);
 
     for(g=0; g < p_fSt->nGroups; g++) {
-        if(p_fSt->assignedTable[g]!=-1)
-            fprintf(fic,"%4d",p_fSt->assignedTable[g]);
-        else {
-            fprintf(fic,"%4s",".");
-        }
+        if(GROUPTABLE(*p_fSt, g) == lastTable[g])
+            continue;
+        lastTable[g] = GROUPTABLE(*p_fSt, g);
+        if(lastTable[g] != -1)
+            len += snprintf(line+len, sizeof(line)-len, " T%d=%d", g, lastTable[g]);
+        else len += snprintf(line+len, sizeof(line)-len, " T%d=.", g);
     }
+    len += snprintf(line+len, sizeof(line)-len, "\n");
 
+    writeLine(nFic, line, len);
+    traceEnd ("log", "saveStateDelta");
+}
 
-    fprintf(fic,"\n");
+/**
+ *  \brief Opening of the record file of the receptionist.
+ *
+ *  The records saved afterwards by the process are written to this file instead of being discarded.
+ *
+ *  \param nRec name of the record file
+ */
+void logRecordOpen (char nRec[])
+{
+    if ((recFic = fopen (nRec, "w")) == NULL) {
+        perror ("error on opening the record file");
+        exit (EXIT_FAILURE);
+    }
+    setvbuf (recFic, NULL, _IOLBF, 0);
+}
 
-    closeLog(fic);
+/**
+ *  \brief Writing the wait predicted for a group as a single line of the record file.
+ *
+ *  Nothing is written if the record file was not opened.
+ *
+ *  \param group group id
+ *  \param wait predicted wait (in us)
+ */
+void saveWaitEstimate (int group, long wait)
+{
+    if (recFic != NULL)
+        fprintf(recFic, "#WAIT G%02d %ld.%03ld\n", group, wait / 1000, wait % 1000);
+}
+
+/**
+ *  \brief Writing a request served by the receptionist as a single line of the record file.
+ *
+ *  Nothing is written if the record file was not opened.
+ *
+ *  \param time time the request was served (in us)
+ *  \param kind <tt>TABLE</tt>, <tt>SEAT</tt> or <tt>BILL</tt>
+ *  \param group group id
+ *  \param table table id, <tt>REQ_WAIT</tt> or <tt>REQ_AWAY</tt>
+ */
+void saveRequestServed (long time, const char *kind, int group, int table)
+{
+    if (recFic == NULL)
+        return;
+
+    fprintf(recFic, "#REQ %ld %s G%02d ", time, kind, group);
+    if (table == REQ_WAIT)
+        fprintf(recFic, "wait\n");
+    else if (table == REQ_AWAY)
+        fprintf(recFic, "away\n");
+    else fprintf(recFic, "%d\n", table);
+}
+
+/**
+ *  \brief Creation of a memory mapped logging file.
+ *
+ *  The lines saved afterwards by any process that opened the file with <tt>logMapOpen</tt> are copied into
+ *  a shared mapping of the file, at a position taken from a write cursor shared by all of them, so that no
+ *  system call is made per line. The file is preallocated by chunks of <tt>LOGCHUNK</tt> bytes, so it must
+ *  be truncated to its real length by <tt>logMapClose</tt>. The file must exist and must not be stdout.
+ *
+ *  \param nFic name of the logging file
+ *  \param cursor write cursor, in the shared region (set to the present end of the file)
+ */
+void logMapCreate (char nFic[], LOG_CURSOR *cursor)
+{
+    cursor->reserved = cursor->committed = (unsigned long) logSize (nFic);
+    logMapOpen (nFic, cursor);
+}
+
+/**
+ *  \brief Opening a memory mapped logging file.
+ *
+ *  The following lines saved by the process are appended to the mapping of the file.
+ *
+ *  \param nFic name of the logging file
+ *  \param cursor write cursor, in the shared region
+ */
+void logMapOpen (char nFic[], LOG_CURSOR *cursor)
+{
+    if ((mapFd = open (nFic, O_RDWR)) == -1) {
+        perror ("error on opening log file");
+        exit (EXIT_FAILURE);
+    }
+    mapCursor = cursor;
+    growMap (__atomic_load_n (&cursor->reserved, __ATOMIC_RELAXED) + 1);
 }
 
+/**
+ *  \brief Closing a memory mapped logging file.
+ *
+ *  The file is truncated to the length of the lines written, once all the processes stopped writing to it.
+ *
+ *  \param nFic name of the logging file
+ *  \param cursor write cursor, in the shared region
+ */
+void logMapClose (char nFic[], LOG_CURSOR *cursor)
+{
+    if ((mapAdd != NULL) && (munmap (mapAdd, mapSize) == -1))
+        perror ("error on unmapping the log file");
+    if (truncate (nFic, (off_t) __atomic_load_n (&cursor->reserved, __ATOMIC_ACQUIRE)) == -1)
+        perror ("error on truncating the log file");
+    if (mapFd != -1)
+        close (mapFd);
+    mapCursor = NULL;
+    mapAdd = NULL;
+    mapFd = -1;
+}
+
+/**
+ *  \brief Opening of a shard of the logging file.
+ *
+ *  The following lines saved by the process are written to its own file, named after the logging file and
+ *  the process (<tt>nFic.name</tt>), each one preceded by a number taken from a sequence counter shared by all
+ *  the processes. The lines of all the shards are merged back into the logging file, in the order of their
+ *  numbers, by <tt>logmerge</tt>. The shard is line buffered, so the lines written before the process is
+ *  killed are kept.
+ *
+ *  \param nFic name of the logging file
+ *  \param name name of the process (<tt>CH</tt>, <tt>WT</tt>, <tt>RC</tt> or <tt>GR</tt> and the group id)
+ *  \param seq sequence counter, in the shared region
+ */
+void logShardOpen (char nFic[], char name[], unsigned long *seq)
+{
+    char nShard[256];
+
+    if (snprintf (nShard, sizeof (nShard), "%s.%s", nFic, name) >= (int) sizeof (nShard)) {
+        fprintf (stderr, "Shard file name is too long!\n");
+        exit (EXIT_FAILURE);
+    }
+    if ((shardFic = fopen (nShard, "w")) == NULL) {
+        perror ("error on opening log shard");
+        exit (EXIT_FAILURE);
+    }
+    setvbuf (shardFic, NULL, _IOLBF, 0);
+    shardSeq = seq;
+}
+
+/**
+ *  \brief Initialization of a log queue.
+ *
+ *  \param q log queue, in the shared region
+ *  \param p_fSt pointer to the full state saved in the last line of the logging file
+ *  \param delta if the lines are delta records
+ */
+void logQueueInit (LOG_QUEUE *q, FULL_STAT *p_fSt, bool delta)
+{
+    int g, r;
+
+    q->next = q->done = 0;
+    q->writer = 0;
+    q->delta = delta;
+    q->fSt = *p_fSt;
+    for (g = 0; g < MAXGROUPS; g++)
+        q->lastTable[g] = GROUPTABLE (*p_fSt, g);
+    for (r = 0; r < LOGQUEUE; r++)
+        q->rec[r].ticket = 0;
+}
+
+/**
+ *  \brief Queuing of a state transition.
+ *
+ *  The transition takes the next ticket and waits in the queue, without any system call, until its line is
+ *  written by <tt>logQueueFlush</tt>. If the queue is full, the calling process writes the lines itself or
+ *  waits for the writer to make room.
+ *
+ *  \param nFic name of the logging file
+ *  \param q log queue, in the shared region
+ *  \param rec transition (its ticket is set)
+ */
+void logQueuePut (char nFic[], LOG_QUEUE *q, LOG_RECORD *rec)
+{
+    LOG_RECORD *slot;
+
+    rec->ticket = __atomic_add_fetch (&q->next, 1, __ATOMIC_RELAXED);
+    slot = &q->rec[rec->ticket % LOGQUEUE];
+    /* the record is free once the line of the ticket that used it before is written */
+    while (__atomic_load_n (&q->done, __ATOMIC_ACQUIRE) + LOGQUEUE < rec->ticket) {
+        logQueueFlush (nFic, q);
+        sched_yield ();
+    }
+    slot->entity = rec->entity;
+    slot->state = rec->state;
+    slot->groupsWaiting = rec->groupsWaiting;
+    memcpy (slot->table, rec->table, sizeof (slot->table));
+    /* sequentially consistent, so that a writer leaving the queue either sees it or is seen (logQueueFlush) */
+    __atomic_store_n (&slot->ticket, rec->ticket, __ATOMIC_SEQ_CST);
+}
+
+/**
+ *  \brief Writing the transitions queued.
+ *
+ *  If no other process is the writer, the lines of the transitions whose tickets follow the last one written
+ *  are written, in the order of their tickets. Otherwise the writer writes them, since it looks for the next
+ *  transition again once it stops being the writer, so the call never waits.
+ *
+ *  \param nFic name of the logging file
+ *  \param q log queue, in the shared region
+ */
+void logQueueFlush (char nFic[], LOG_QUEUE *q)
+{
+    LOG_RECORD *r;
+    unsigned long t;
+    int free;
+
+    while (true) {
+        t = __atomic_load_n (&q->done, __ATOMIC_SEQ_CST) + 1;
+        if (__atomic_load_n (&q->rec[t % LOGQUEUE].ticket, __ATOMIC_SEQ_CST) != t)
+            return;
+        free = 0;
+        if (!__atomic_compare_exchange_n (&q->writer, &free, 1, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+            return;
+
+        /* the writer is the only process that changes q->fSt, q->lastTable and q->done */
+        for (t = q->done + 1; __atomic_load_n (&(r = &q->rec[t % LOGQUEUE])->ticket, __ATOMIC_ACQUIRE) == t; t++) {
+            switch (r->entity) {
+                case LOG_CHEF:
+                    q->fSt.st.chefStat = r->state;
+                    break;
+                case LOG_WAITER:
+                    q->fSt.st.waiterStat = r->state;
+                    break;
+                case LOG_RECEPTIONIST:
+                    q->fSt.st.receptionistStat = r->state;
+                    break;
+                case LOG_TABLES:
+                    q->fSt.groupsWaiting = r->groupsWaiting;
+                    memcpy (&GROUPTABLE (q->fSt, 0), r->table, sizeof (r->table));
+                    break;
+                default:
+                    GROUPSTAT (q->fSt.st, r->entity) = r->state;
+            }
+            if (r->entity != LOG_TABLES) {
+                if (q->delta)
+                    saveStateDelta (nFic, &q->fSt, r->entity, q->lastTable);
+                else saveState (nFic, &q->fSt);
+            }
+            __atomic_store_n (&q->done, t, __ATOMIC_RELEASE);
+        }
+        __atomic_store_n (&q->writer, 0, __ATOMIC_SEQ_CST);
+    }
+}
@@ -7,7 +7,15 @@
  *
  *  Defined operations:
  *     \li file initialization
- *     \li writing the present full state as a single line at the end of the file.
+ *     \li writing the present full state as a single line at the end of the file
+ *     \li size of the file
+ *     \li writing the change made by a state transition as a single line at the end of the file
+ *     \li creation, opening and closing of a memory mapped logging file
+ *     \li opening of a shard of the logging file
+ *     \li initialization of a log queue, queuing of a state transition and writing of the transitions queued
+ *     \li opening of the record file of the receptionist
+ *     \li writing the wait predicted for a group as a single line of the record file
+ *     \li writing a request served by the receptionist as a single line of the record file.
  *
  *  \author Nuno Lau - December 2023
  */
@@ -17,6 +25,74 @@
 
 #include "probDataStruct.h"
 
+/**
+ *  \brief Definition of the write cursor of a memory mapped logging file.
+ *
+ *  The lines are appended one process at a time, inside the critical region (or by the writer of the log
+ *  queue), so the lines up to <tt>committed</tt> are complete.
+ */
+typedef struct {
+    /** \brief length of the lines written or being written (in bytes) */
+    unsigned long reserved;
+    /** \brief length of the lines completely written (in bytes) */
+    unsigned long committed;
+} LOG_CURSOR;
+
+/** \brief chef, as the entity of a delta record (the groups are identified by their ids) */
+#define  LOG_CHEF            -1
+/** \brief waiter, as the entity of a delta record */
+#define  LOG_WAITER          -2
+/** \brief receptionist, as the entity of a delta record */
+#define  LOG_RECEPTIONIST    -3
+/** \brief tables of the groups and number of groups waiting, as the entity of a queued record (no line) */
+#define  LOG_TABLES          -4
+
+/** \brief number of records of a log queue */
+#define  LOGQUEUE            64
+
+/**
+ *  \brief Definition of a state transition waiting in a log queue.
+ */
+typedef struct {
+    /** \brief ticket of the transition, which sets its place in the log (0 if the record is free) */
+    unsigned long ticket;
+    /** \brief group id, or <tt>LOG_CHEF</tt>, <tt>LOG_WAITER</tt>, <tt>LOG_RECEPTIONIST</tt> or <tt>LOG_TABLES</tt> */
+    int entity;
+    /** \brief new state of the entity */
+    unsigned int state;
+    /** \brief number of groups waiting for a table (<tt>LOG_TABLES</tt> only) */
+    int groupsWaiting;
+    /** \brief table used by each group (<tt>LOG_TABLES</tt> only) */
+    TABLE_ID table[MAXGROUPS];
+} LOG_RECORD;
+
+/**
+ *  \brief Definition of a log queue.
+ *
+ *  The entities change their states without excluding each other, so the order of the lines of the log is set
+ *  by a ticket taken by each transition. The transitions wait in the queue until the lines of the previous
+ *  tickets are written, and their lines are written by one process at a time, the writer.
+ */
+typedef struct {
+    /** \brief last ticket taken */
+    unsigned long next;
+    /** \brief last ticket whose line was written */
+    unsigned long done;
+    /** \brief if a process is writing the lines of the queue */
+    int writer;
+    /** \brief if the lines are delta records */
+    bool delta;
+    /** \brief table of each group in the last line written (delta records) */
+    TABLE_ID lastTable[MAXGROUPS];
+    /** \brief full state as of the last ticket whose line was written */
+    FULL_STAT fSt;
+    /** \brief transitions waiting, the one of ticket <tt>t</tt> in record <tt>t % LOGQUEUE</tt> */
+    LOG_RECORD rec[LOGQUEUE];
+} LOG_QUEUE;
+
+/** \brief maximum length of the name of the record file (including the terminating null) */
+#define  RECORD_NAMELEN      51
+
 /**
  *  \brief File initialization.
  *
@@ -41,4 +117,163 @@ extern void createLog (char nFic[], FULL_STAT *p_fSt);
  */
 extern void saveState (char nFic[], FULL_STAT *p_fSt);
 
+/**
+ *  \brief Size of the logging file.
+ *
+ *  \param nFic name of the logging file
+ *
+ *  \return size of the file (in bytes), or -\c 1 if stdout is used
+ */
+extern long logSize (char nFic[]);
+
+/**
+ *  \brief Writing the change made by a state transition as a single line at the end of the file.
+ *
+ *  If <tt>nFic</tt> is a null pointer or a null string, the lines are written to stdout.
+ *
+ *  Instead of the full state, the line (a delta record) holds only what changed since the previous line:
+ *    \li <tt>@</tt> followed by the entity that changed its state (<tt>CH</tt>, <tt>WT</tt>, <tt>RC</tt> or
+ *        <tt>G</tt> and the group id)
+ *    \li its new state
+ *    \li the number of groups waiting for a table
+ *    \li <tt>T</tt><em>group</em><tt>=</tt><em>table</em> for each group whose table changed (<tt>.</tt> if
+ *        it has none).
+ *
+ *  The size of the line does not depend on the number of groups. <tt>expand_log.awk</tt> turns the delta
+ *  records back into full state lines, starting from the last full state line of the file.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *  \param entity group id, or <tt>LOG_CHEF</tt>, <tt>LOG_WAITER</tt> or <tt>LOG_RECEPTIONIST</tt>
+ *  \param lastTable table of each group in the previous line of the file (updated)
+ */
+extern void saveStateDelta (char nFic[], FULL_STAT *p_fSt, int entity, TABLE_ID lastTable[]);
+
+/**
+ *  \brief Opening of the record file of the receptionist.
+ *
+ *  The records saved afterwards by the process are written to this file instead of being discarded. The
+ *  receptionist is its only writer, so the records keep its order whatever the logging mode, and the
+ *  logging file holds nothing but state lines. The file is line buffered.
+ *
+ *  \param nRec name of the record file
+ */
+extern void logRecordOpen (char nRec[]);
+
+/**
+ *  \brief Writing the wait predicted for a group as a single line of the record file.
+ *
+ *  The line is <tt>#WAIT Gnn ms</tt>. Nothing is written if the record file was not opened.
+ *
+ *  \param group group id
+ *  \param wait predicted wait (in us)
+ */
+extern void saveWaitEstimate (int group, long wait);
+
+/** \brief table of a table request served by the receptionist: the group waits */
+#define  REQ_WAIT        (-1)
+/** \brief table of a table request served by the receptionist: the group is turned away */
+#define  REQ_AWAY        (-2)
+
+/**
+ *  \brief Writing a request served by the receptionist as a single line of the record file.
+ *
+ *  The line is <tt>#REQ time kind Gnn table</tt>, where <tt>time</tt> is the time the request was served
+ *  (monotonic clock, in us) and <tt>kind</tt> is
+ *     \li <tt>TABLE</tt>: new table request; <tt>table</tt> is the table assigned, <tt>wait</tt> or <tt>away</tt>
+ *     \li <tt>SEAT</tt>: a waiting group is assigned <tt>table</tt>, vacated by the payment served just before
+ *     \li <tt>BILL</tt>: payment; <tt>table</tt> is the table vacated.
+ *
+ *  These lines give the order and the time of the decisions of the receptionist, which <tt>replay</tt> re-drives.
+ *  Nothing is written if the record file was not opened.
+ *
+ *  \param time time the request was served (in us)
+ *  \param kind <tt>TABLE</tt>, <tt>SEAT</tt> or <tt>BILL</tt>
+ *  \param group group id
+ *  \param table table id, <tt>REQ_WAIT</tt> or <tt>REQ_AWAY</tt>
+ */
+extern void saveRequestServed (long time, const char *kind, int group, int table);
+
+/**
+ *  \brief Creation of a memory mapped logging file.
+ *
+ *  The lines saved afterwards by any process that opened the file with <tt>logMapOpen</tt> are copied into
+ *  a shared mapping of the file, at a position taken from a write cursor shared by all of them, so that no
+ *  system call is made per line. The file is preallocated by large chunks, so it must be truncated to its
+ *  real length by <tt>logMapClose</tt>. The file must exist and must not be stdout.
+ *
+ *  \param nFic name of the logging file
+ *  \param cursor write cursor, in the shared region (set to the present end of the file)
+ */
+extern void logMapCreate (char nFic[], LOG_CURSOR *cursor);
+
+/**
+ *  \brief Opening a memory mapped logging file.
+ *
+ *  The following lines saved by the process are appended to the mapping of the file.
+ *
+ *  \param nFic name of the logging file
+ *  \param cursor write cursor, in the shared region
+ */
+extern void logMapOpen (char nFic[], LOG_CURSOR *cursor);
+
+/**
+ *  \brief Closing a memory mapped logging file.
+ *
+ *  The file is truncated to the length of the lines written, once all the processes stopped writing to it.
+ *
+ *  \param nFic name of the logging file
+ *  \param cursor write cursor, in the shared region
+ */
+extern void logMapClose (char nFic[], LOG_CURSOR *cursor);
+
+/**
+ *  \brief Opening of a shard of the logging file.
+ *
+ *  The following lines saved by the process are written to its own file, named after the logging file and
+ *  the process (<tt>nFic.name</tt>), each one preceded by a number taken from a sequence counter shared by all
+ *  the processes. The lines of all the shards are merged back into the logging file, in the order of their
+ *  numbers, by <tt>logmerge</tt>.
+ *
+ *  \param nFic name of the logging file
+ *  \param name name of the process (<tt>CH</tt>, <tt>WT</tt>, <tt>RC</tt> or <tt>GR</tt> and the group id)
+ *  \param seq sequence counter, in the shared region
+ */
+extern void logShardOpen (char nFic[], char name[], unsigned long *seq);
+
+/**
+ *  \brief Initialization of a log queue.
+ *
+ *  \param q log queue, in the shared region
+ *  \param p_fSt pointer to the full state saved in the last line of the logging file
+ *  \param delta if the lines are delta records
+ */
+extern void logQueueInit (LOG_QUEUE *q, FULL_STAT *p_fSt, bool delta);
+
+/**
+ *  \brief Queuing of a state transition.
+ *
+ *  The transition takes the next ticket and waits in the queue, without any system call, until its line is
+ *  written by <tt>logQueueFlush</tt>. If the queue is full, the calling process writes the lines itself or
+ *  waits for the writer to make room.
+ *
+ *  \param nFic name of the logging file
+ *  \param q log queue, in the shared region
+ *  \param rec transition (its ticket is set)
+ */
+extern void logQueuePut (char nFic[], LOG_QUEUE *q, LOG_RECORD *rec);
+
+/**
+ *  \brief Writing the transitions queued.
+ *
+ *  If no other process is the writer, the lines of the transitions whose tickets follow the last one written
+ *  are written, in the order of their tickets, as full state lines or delta records (<tt>LOG_TABLES</tt>
+ *  records only change the tables of the following lines). Otherwise the writer writes them, so the call
+ *  never waits. Every process that queues transitions must call it after queuing them.
+ *
+ *  \param nFic name of the logging file
+ *  \param q log queue, in the shared region
+ */
+extern void logQueueFlush (char nFic[], LOG_QUEUE *q);
+
 #endif /* LOGGING_H_ */
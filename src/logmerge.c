@@ -0,0 +1,154 @@
+/**
+ *  \file logmerge.c (implementation file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  Merging of the shards of a logging file.
+ *
+ *  When the simulation is run with <tt>-S</tt>, the logging file holds only its header and the initial state,
+ *  and each entity writes its lines to its own shard, each one preceded by a global sequence number. The
+ *  shards are merged (k-way, through a min-heap keyed by the sequence number of their next line) and the
+ *  lines are written to stdout, without their numbers, after those of the logging file, which rebuilds the
+ *  log that would have been written without <tt>-S</tt>. Gaps in the sequence (lines lost by a process that
+ *  was killed) are reported on stderr.
+ *
+ *  Upon execution, the following parameters are accepted:
+ *    \li name of the logging file
+ *    \li names of the shards (<tt>logFile.*</tt>).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+/**
+ *  \brief Definition of a shard being merged.
+ */
+typedef struct {
+    /** \brief shard file */
+    FILE *fic;
+    /** \brief name of the shard */
+    char *name;
+    /** \brief next line of the shard (without its number) */
+    char *line;
+    /** \brief size of the buffer holding the line */
+    size_t size;
+    /** \brief sequence number of the line */
+    unsigned long seq;
+} SHARD;
+
+/** \brief min-heap of the shards that have lines left, keyed by the sequence number of their next line */
+static SHARD **heap;
+
+/** \brief number of shards in the heap */
+static int heapLen = 0;
+
+/**
+ *  \brief Reading the next line of a shard.
+ *
+ *  \return <tt>true</tt> if a line was read, <tt>false</tt> at the end of the shard
+ */
+static bool nextLine (SHARD *s)
+{
+    char *rest;
+    ssize_t len;
+
+    while ((len = getline (&s->line, &s->size, s->fic)) != -1) {
+        s->seq = strtoul (s->line, &rest, 10);
+        if ((rest != s->line) && (*rest == ' ')) {
+            memmove (s->line, rest + 1, len - (rest + 1 - s->line) + 1);
+            return true;
+        }
+        fprintf (stderr, "%s: line without a sequence number ignored\n", s->name);
+    }
+    return false;
+}
+
+/**
+ *  \brief Moving the shard at position <tt>i</tt> of the heap down to its place.
+ */
+static void siftDown (int i)
+{
+    int child;
+    SHARD *s;
+
+    while ((child = 2 * i + 1) < heapLen) {
+        if ((child + 1 < heapLen) && (heap[child + 1]->seq < heap[child]->seq))
+            child += 1;
+        if (heap[i]->seq <= heap[child]->seq)
+            break;
+        s = heap[i]; heap[i] = heap[child]; heap[child] = s;
+        i = child;
+    }
+}
+
+/**
+ *  \brief Main program.
+ *
+ *  Its role is to write the logging file and the merged lines of its shards to stdout.
+ */
+int main (int argc, char *argv[])
+{
+    FILE *fic;
+    SHARD *shards;
+    char buf[512];
+    size_t n;
+    int i;
+    unsigned long expected = 1;                                      /* line 0 is in the logging file */
+
+    if (argc < 2) {
+        fprintf (stderr, "Usage: %s logFile [shard ...]\n", argv[0]);
+        exit (EXIT_FAILURE);
+    }
+
+    /* header and initial state */
+    if ((fic = fopen (argv[1], "r")) == NULL) {
+        perror ("error on opening the log file");
+        exit (EXIT_FAILURE);
+    }
+    while ((n = fread (buf, 1, sizeof (buf), fic)) > 0)
+        fwrite (buf, 1, n, stdout);
+    fclose (fic);
+
+    if (((shards = calloc (argc - 2 + 1, sizeof (SHARD))) == NULL) ||
+        ((heap = calloc (argc - 2 + 1, sizeof (SHARD *))) == NULL)) {
+        perror ("error on allocating memory");
+        exit (EXIT_FAILURE);
+    }
+    for (i = 2; i < argc; i++) {
+        SHARD *s = &shards[i - 2];
+
+        s->name = argv[i];
+        if ((s->fic = fopen (argv[i], "r")) == NULL) {
+            perror (argv[i]);
+            exit (EXIT_FAILURE);
+        }
+        if (nextLine (s))
+            heap[heapLen++] = s;
+    }
+    for (i = heapLen / 2 - 1; i >= 0; i--)
+        siftDown (i);
+
+    /* k-way merge */
+    while (heapLen > 0) {
+        SHARD *s = heap[0];
+
+        if (s->seq != expected)
+            fprintf (stderr, "%s: line %lu follows line %lu\n", s->name, s->seq, expected - 1);
+        expected = s->seq + 1;
+        fputs (s->line, stdout);
+        if (!nextLine (s))
+            heap[0] = heap[--heapLen];
+        siftDown (0);
+    }
+
+    for (i = 0; i < argc - 2; i++) {
+        fclose (shards[i].fic);
+        free (shards[i].line);
+    }
+    free (shards);
+    free (heap);
+
+    return EXIT_SUCCESS;
+}
@@ -33,6 +33,8 @@
 #define FOODREQ   3
 /** \brief id of food ready (chef->waiter) */
 #define FOODREADY 4
+/** \brief id of drain request (main process->waiter and receptionist, in daemon mode) */
+#define DRAINREQ  5
 
 /* Client state constants */
 
@@ -7,6 +7,27 @@
  *
  *  They specify internal metadata about the status of the intervening entities.
  *
+ *  When compiled with <tt>ALIGNEDLAYOUT</tt>, each field written by a single entity (its state word, the
+ *  mailboxes) starts its own cache line and the read-mostly configuration is kept apart from them, so that
+ *  a state change does not invalidate the cache lines read or written by the other entities. The layout is
+ *  then incompatible with the precompiled binaries. The state of the groups must be accessed through
+ *  <tt>GROUPSTAT</tt>, which does not depend on the layout.
+ *
+ *  When compiled with <tt>PACKEDSTAT</tt>, the states are stored in <tt>STATE_WORD</tt> (8 bits) and the
+ *  table ids in <tt>TABLE_ID</tt> (16 bits, signed so that -1 still means no table) instead of 32-bit
+ *  integers, so the state of the intervening entities is 4 times smaller and so are the snapshots taken
+ *  from it. The start and eat times are in microseconds and are kept as integers. This layout is also
+ *  incompatible with the precompiled binaries.
+ *
+ *  When compiled with <tt>GROUPBLOCKS</tt>, the data of the groups is split by frequency of access: the hot
+ *  block (<tt>GROUP_HOT</tt>: states and tables, changed by the transitions) is kept inside the state of the
+ *  intervening entities and the cold block (<tt>GROUP_COLD</tt>: start and eat times, read once) apart from
+ *  it, each one contiguous and starting its own cache line, so that scanning the groups touches as few cache
+ *  lines as possible. The per-group data must then be accessed through <tt>GROUPSTAT</tt>,
+ *  <tt>GROUPTABLE</tt>, <tt>GROUPSTART</tt> and <tt>GROUPEAT</tt>, which do not depend on the layout. The
+ *  statistics of the groups (<tt>GROUP_STATS</tt>) are a third block, kept in the shared region in every
+ *  layout.
+ *
  *  \author Nuno Lau - December 2023
  */
 
@@ -14,9 +35,99 @@
 #define PROBDATASTRUCT_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "probConst.h"
 
+#ifdef PACKEDSTAT
+/** \brief storage of the state of an intervening entity */
+typedef uint8_t STATE_WORD;
+/** \brief storage of a table id (-1 if none) */
+typedef int16_t TABLE_ID;
+#else
+/** \brief storage of the state of an intervening entity */
+typedef unsigned int STATE_WORD;
+/** \brief storage of a table id (-1 if none) */
+typedef int TABLE_ID;
+#endif
+
+/** \brief size of a cache line (in bytes) */
+#define  CACHELINE        64
+
+#ifdef ALIGNEDLAYOUT
+/** \brief places a field at the start of a cache line of its own */
+#define  ALIGNED          __attribute__ ((aligned (CACHELINE)))
+
+/**
+ *  \brief Definition of a state word padded to a whole cache line.
+ */
+typedef struct {
+    /** \brief state */
+    STATE_WORD val ALIGNED;
+} ALIGNED_STAT;
+
+#else
+#define  ALIGNED
+#endif
+
+#ifdef GROUPBLOCKS
+/** \brief places a block of per-group data at the start of a cache line */
+#define  BLOCKALIGNED     __attribute__ ((aligned (CACHELINE)))
+
+/**
+ *  \brief Definition of the per-group data changed by the state transitions.
+ */
+typedef struct {
+    /** \brief state of each group */
+    STATE_WORD stat[MAXGROUPS];
+    /** \brief table used by each group (-1 if none) */
+    TABLE_ID table[MAXGROUPS];
+} GROUP_HOT;
+
+/**
+ *  \brief Definition of the per-group configuration.
+ */
+typedef struct {
+    /** \brief estimated start time of each group */
+    int startTime[MAXGROUPS];
+    /** \brief estimated eat time of each group */
+    int eatTime[MAXGROUPS];
+} GROUP_COLD;
+
+/** \brief state of group <tt>g</tt> in the state of the intervening entities <tt>st</tt> */
+#define  GROUPSTAT(st, g)       ((st).group.stat[g])
+/** \brief table used by group <tt>g</tt> in the full state <tt>fSt</tt> */
+#define  GROUPTABLE(fSt, g)     ((fSt).st.group.table[g])
+/** \brief estimated start time of group <tt>g</tt> in the full state <tt>fSt</tt> */
+#define  GROUPSTART(fSt, g)     ((fSt).groupCfg.startTime[g])
+/** \brief estimated eat time of group <tt>g</tt> in the full state <tt>fSt</tt> */
+#define  GROUPEAT(fSt, g)       ((fSt).groupCfg.eatTime[g])
+#else
+#ifdef ALIGNEDLAYOUT
+/** \brief state of group <tt>g</tt> in the state of the intervening entities <tt>st</tt> */
+#define  GROUPSTAT(st, g)       ((st).groupStat[g].val)
+#else
+/** \brief state of group <tt>g</tt> in the state of the intervening entities <tt>st</tt> */
+#define  GROUPSTAT(st, g)       ((st).groupStat[g])
+#endif
+/** \brief table used by group <tt>g</tt> in the full state <tt>fSt</tt> */
+#define  GROUPTABLE(fSt, g)     ((fSt).assignedTable[g])
+/** \brief estimated start time of group <tt>g</tt> in the full state <tt>fSt</tt> */
+#define  GROUPSTART(fSt, g)     ((fSt).startTime[g])
+/** \brief estimated eat time of group <tt>g</tt> in the full state <tt>fSt</tt> */
+#define  GROUPEAT(fSt, g)       ((fSt).eatTime[g])
+#endif
+
+/**
+ *  \brief Definition of the statistics of the groups.
+ */
+typedef struct {
+    /** \brief time when each group entered its present state (in ns, 0 before its first transition) */
+    unsigned long since[MAXGROUPS];
+    /** \brief total time spent by each group in each state (in ns) */
+    unsigned long stateTime[MAXGROUPS][LEAVING+1];
+} GROUP_STATS;
+
 /**
  *  \brief Definition of requests to receptionist and waiter 
  */
@@ -33,13 +144,19 @@ typedef struct {
  */
 typedef struct {
     /** \brief receptionist state */
-    unsigned int receptionistStat;
+    STATE_WORD receptionistStat ALIGNED;
     /** \brief waiter state */
-    unsigned int waiterStat;
+    STATE_WORD waiterStat ALIGNED;
     /** \brief chef state */
-    unsigned int chefStat;
-    /** \brief group state array */
-    unsigned int groupStat[MAXGROUPS];
+    STATE_WORD chefStat ALIGNED;
+    /** \brief group state array, or hot block of the groups (to be accessed through <tt>GROUPSTAT</tt>) */
+#if defined (GROUPBLOCKS)
+    GROUP_HOT group BLOCKALIGNED;
+#elif defined (ALIGNEDLAYOUT)
+    ALIGNED_STAT groupStat[MAXGROUPS];
+#else
+    STATE_WORD groupStat[MAXGROUPS];
+#endif
 
 } STAT;
 
@@ -52,29 +169,34 @@ typedef struct
     STAT st;
 
     /** \brief number of groups */
-    int nGroups;
+    int nGroups ALIGNED;
     /** \brief number of groups waiting for table */
-    int groupsWaiting;
+    int groupsWaiting ALIGNED;
 
+#ifdef GROUPBLOCKS
+    /** \brief configuration of the groups (to be accessed through <tt>GROUPSTART</tt> and <tt>GROUPEAT</tt>) */
+    GROUP_COLD groupCfg BLOCKALIGNED;
+#else
     /** \brief estimated start time of groups */
-    int startTime[MAXGROUPS];
+    int startTime[MAXGROUPS] ALIGNED;
     /** \brief estimated eat time of groups */
     int eatTime[MAXGROUPS];
 
-    /** \brief saves the table that is being used by each group */
-    int assignedTable[MAXGROUPS];
+    /** \brief saves the table that is being used by each group (to be accessed through <tt>GROUPTABLE</tt>) */
+    TABLE_ID assignedTable[MAXGROUPS] ALIGNED;
+#endif
 
     /** \brief flag of food request from waiter to chef */
-    int foodOrder;
+    int foodOrder ALIGNED;
     /** \brief group associated to food request from waiter to chef */
     int foodGroup;
 
 
     /** \brief used by groups to store request to receptionist */
-    request receptionistRequest;
+    request receptionistRequest ALIGNED;
 
     /** \brief used by groups and chef to store request to waiter */
-    request waiterRequest;
+    request waiterRequest ALIGNED;
 
 
 } FULL_STAT;
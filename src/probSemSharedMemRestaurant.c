@@ -8,8 +8,58 @@
  *
  *  Generator process of the intervening entities.
  *
- *  Upon execution, one parameter is requested:
- *    \li name of the logging file.
+ *  Upon execution, the following parameters are accepted:
+ *    \li <tt>-s stallTime</tt>: time without any state transition, in milliseconds, while every entity is
+ *        blocked on a semaphore, after which the simulation is considered deadlocked (optional, 5000 by default)
+ *    \li <tt>-T traceFile</tt>: name of the Chrome Trace Event file where the timeline of the semaphore
+ *        operations, log writes and group phases is recorded (optional)
+ *    \li <tt>-H histFile</tt>: name of the CSV file where the histograms of the time spent by the entities in
+ *        each state are dumped (optional)
+ *    \li <tt>-R recFile</tt>: name of the file where the receptionist records the wait it predicts for each
+ *        group on its table requests (<tt>#WAIT Gnn ms</tt> lines) and the requests it serves, with their
+ *        time, which <tt>replay</tt> reads (<tt>#REQ</tt> lines, see logging.h; optional, all entities must be
+ *        built from source)
+ *    \li <tt>-v</tt>: reports printed on stderr at exit, the percentiles of the time spent by the entities in
+ *        each state, the time spent by each group in each state, the contention of the semaphores and the
+ *        page faults (optional)
+ *    \li <tt>-M memOptions</tt>: comma separated options of the shared memory region (optional):
+ *        <tt>huge</tt> to back it by huge pages (normal pages are used if they are not available),
+ *        <tt>prefault</tt> to fault its pages in before the simulation starts, both in this process and in
+ *        the intervening entities, <tt>lock</tt> to lock it in memory (implies <tt>prefault</tt>) and
+ *        <tt>memfd</tt> to back it by an anonymous memory file inherited by the intervening entities instead
+ *        of a System V segment (they must then be built from source, and it can not be monitored by
+ *        <tt>restmon</tt>); the page faults are then reported at exit
+ *    \li <tt>-d</tt>: delta logging, each state transition is logged as a record of what changed instead of
+ *        the full state (optional; <tt>expand_log.awk</tt> turns the records back into full state lines)
+ *    \li <tt>-m</tt>: memory mapped logging, the entities copy their lines into a shared mapping of the logging
+ *        file, which is preallocated by large chunks and truncated to its real length at exit (optional; the
+ *        logging file must be given)
+ *    \li <tt>-z</tt>: compressed logging, the logging file is written in gzip format (optional; implies
+ *        <tt>-m</tt>: the entities write to a spool file, in <tt>/dev/shm</tt> if it exists, which this
+ *        process drains into the logging file; read it with <tt>zcat</tt>)
+ *    \li <tt>-S</tt>: sharded logging, each entity writes its lines to its own file (<tt>logFile.CH</tt>,
+ *        <tt>logFile.GR00</tt>, ...) tagged with a global sequence number, so the entities never write to the
+ *        same file; <tt>logmerge logFile logFile.*</tt> rebuilds the log (optional; the logging file must be
+ *        given and it can not be memory mapped)
+ *    \li <tt>-W workload</tt>: source of the arrivals and eating times of the groups, <tt>config.txt</tt> by
+ *        default; another configuration file, a text or binary trace of arrivals (of which a window of up to
+ *        <tt>MAXGROUPS</tt> arrivals is streamed) or open loop Poisson or bursty (MMPP) arrivals, e.g.
+ *        <tt>-W mmpp,groups=16,gap=20000,rush=2000,dwell=100000,eat=300000</tt> (optional; see workload.h)
+ *    \li <tt>-D runTime</tt>: daemon mode, each group comes back after leaving for the next arrival drawn from
+ *        the workload (see workload.h) until the restaurant is drained, <tt>runTime</tt> seconds after the start,
+ *        on <tt>SIGINT</tt> or <tt>SIGTERM</tt> (<tt>0</tt> to wait for the signal) or at the end of a trace; the
+ *        groups then finish their visits and the chef,
+ *        the waiter and the receptionist are stopped by a drain request, and the throughput is printed
+ *        (optional; all entities must be built from source)
+ *    \li <tt>-A admission</tt>: admission control, comma separated limits on the groups that may join the
+ *        waiting room, <tt>queue=n</tt> (waiting groups) and <tt>wait=t</tt> (estimated wait, from the eating
+ *        times of the seated and waiting groups); a group turned away comes back after <tt>backoff=t</tt>,
+ *        doubled after each refusal (times in microseconds; optional; all entities must be built from source)
+ *    \li <tt>-C stations</tt>: number of stations of the chef, who keeps accepting orders while cooking and
+ *        cooks up to <tt>stations</tt> of them at the same time, each one handed to the waiter as soon as it is
+ *        ready (at most <tt>NUMTABLES</tt>, as many as the orders that may be pending; optional, 1 by default;
+ *        the chef must be built from source)
+ *    \li name of the logging file (optional, stdout by default).
  *
  *  \author Nuno Lau - December 2023
  */
@@ -18,18 +68,27 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
 #include <sys/wait.h>
 #include <sys/types.h>
 #include <sys/ipc.h>
+#include <sys/resource.h>
 #include <string.h>
 #include <math.h>
+#include <limits.h>
 
 #include "probConst.h"
 #include "probDataStruct.h"
 #include "logging.h"
+#include "logCompress.h"
+#include "workload.h"
 #include "sharedDataSync.h"
 #include "semaphore.h"
 #include "sharedMemory.h"
+#include "trace.h"
+#include "histogram.h"
 
 #include "semDebug_sharedDataSync.h"
 
@@ -45,6 +104,334 @@
 /** \brief name of chef process */
 #define   RECEPTIONIST       "./receptionist"
 
+/** \brief default time without progress, with every entity blocked, after which the simulation is considered
+ *  deadlocked (in ms) */
+#define   STALLTIME          5000
+
+/** \brief default initial back-off of a group turned away by admission control (in us) */
+#define   ADMITBACKOFF       10000
+
+/** \brief period of the progress checks carried out by the watchdog (in ms) */
+#define   WATCHDOGPERIOD     10
+
+/** \brief period of the checks while a suspected deadlock is not confirmed (in us) */
+#define   CONFIRMPERIOD      100
+
+/**
+ *  \brief Name of the entity associated to a node of the wait-for graph.
+ */
+static void nodeName (int n, char *out, size_t size)
+{
+    switch (n) {
+        case WFG_CHEF:         snprintf (out, size, "CH"); break;
+        case WFG_WAITER:       snprintf (out, size, "WT"); break;
+        case WFG_RECEPTIONIST: snprintf (out, size, "RC"); break;
+        default:               snprintf (out, size, "G%02d", n);
+    }
+}
+
+/**
+ *  \brief Printing the deadlocked entities, what they are blocked on and who is expected to unblock them.
+ *
+ *  \param sh pointer to shared memory region
+ */
+static void printWaitFor (SHARED_DATA *sh)
+{
+    bool dead[WFG_NODES];
+    char name[8], sem[100];
+    int n;
+
+    wfgFindDeadlock (&sh->wfg, sh->fSt.nGroups, dead);
+    fprintf (stderr, "Wait-for graph of the deadlocked entities:\n");
+    for (n = 0; n < WFG_NODES; n++) {
+        WFG_NODE *node = &sh->wfg.node[n];
+
+        if (!dead[n])
+            continue;
+        nodeName (n, name, sizeof (name));
+        get_semaphore_name (&sh->fSt, node->blockedOn, sem, sizeof (sem));
+        fprintf (stderr, "  %-3s (pid %d) blocked on %2u %-28s waiting for:%s%s%s%s",
+                 name, node->pid, node->blockedOn, sem,
+                 (node->signallers & WFG_BY_CHEF) ? " CH" : "",
+                 (node->signallers & WFG_BY_WAITER) ? " WT" : "",
+                 (node->signallers & WFG_BY_RECEPTIONIST) ? " RC" : "",
+                 (node->signallers & WFG_BY_GROUPS) ? " groups" : "");
+        if (node->signallers & WFG_BY_HOLDER) {
+            nodeName (sh->wfg.mutexHolder, name, sizeof (name));
+            fprintf (stderr, " %s (mutex holder)", (sh->wfg.mutexHolder < 0) ? "?" : name);
+        }
+        fprintf (stderr, "\n");
+    }
+}
+
+/**
+ *  \brief Marks the node of a terminated entity as exited.
+ */
+static void setExited (SHARED_DATA *sh, pid_t pid)
+{
+    int n;
+
+    for (n = 0; n < WFG_NODES; n++)
+        if (sh->wfg.node[n].pid == pid)
+            __atomic_store_n (&sh->wfg.node[n].exited, true, __ATOMIC_RELEASE);
+}
+
+/**
+ *  \brief Printing the time spent by the entities in each state.
+ *
+ *  A table of percentiles is printed on stderr if <tt>verbose</tt> and, if <tt>nFicHist</tt> is not a null
+ *  string, the buckets of all histograms are dumped in CSV format to that file.
+ *
+ *  \param sh pointer to shared memory region
+ *  \param nFicHist name of the CSV file
+ *  \param verbose if the table of percentiles is printed
+ */
+static void printStateTimes (SHARED_DATA *sh, char nFicHist[], bool verbose)
+{
+    FILE *out = verbose ? stderr : NULL, *csv = NULL;
+    char name[40];
+    int s;
+
+    if ((strlen (nFicHist) != 0) && ((csv = fopen (nFicHist, "w")) == NULL))
+        perror ("error on opening the histogram file");
+    if (csv != NULL)
+        fprintf (csv, "state,lowNs,highNs,count\n");
+
+    if (out != NULL) {
+        fprintf (out, "Time spent in each state:\n");
+        histPrintHeader (out);
+    }
+    for (s = 0; s <= LEAVING; s++) {
+        snprintf (name, sizeof (name), "GR %s", get_group_stage_label (s));
+        if (out != NULL) histPrint (out, name, &sh->groupStateTime[s]);
+        if (csv != NULL) histPrintCsv (csv, name, &sh->groupStateTime[s]);
+    }
+    for (s = 0; s <= REST; s++) {
+        snprintf (name, sizeof (name), "CH %s", get_chef_stage_label (s));
+        if (out != NULL) histPrint (out, name, &sh->chefStateTime[s]);
+        if (csv != NULL) histPrintCsv (csv, name, &sh->chefStateTime[s]);
+    }
+    for (s = 0; s <= TAKE_TO_TABLE; s++) {
+        snprintf (name, sizeof (name), "WT %s", get_waiter_stage_label (s));
+        if (out != NULL) histPrint (out, name, &sh->waiterStateTime[s]);
+        if (csv != NULL) histPrintCsv (csv, name, &sh->waiterStateTime[s]);
+    }
+    for (s = 0; s <= RECVPAY; s++) {
+        snprintf (name, sizeof (name), "RC %s", get_receptionist_stage_label (s));
+        if (out != NULL) histPrint (out, name, &sh->receptionistStateTime[s]);
+        if (csv != NULL) histPrintCsv (csv, name, &sh->receptionistStateTime[s]);
+    }
+
+    if ((csv != NULL) && (fclose (csv) == EOF))
+        perror ("error on closing the histogram file");
+}
+
+/**
+ *  \brief Printing the total time spent by each group in each state (but the final one).
+ *
+ *  \param sh pointer to shared memory region
+ */
+static void printGroupTimes (SHARED_DATA *sh)
+{
+    int g, s;
+
+    fprintf (stderr, "Time spent by each group in each state (ms):\n%-6s", "group");
+    for (s = GOTOREST; s < LEAVING; s++)
+        fprintf (stderr, " %14s", get_group_stage_label (s));
+    fprintf (stderr, "\n");
+    for (g = 0; g < sh->fSt.nGroups; g++) {
+        fprintf (stderr, "%-6d", g);
+        for (s = GOTOREST; s < LEAVING; s++)
+            fprintf (stderr, " %14.3f", sh->groupStats.stateTime[g][s] / 1e6);
+        fprintf (stderr, "\n");
+    }
+}
+
+/**
+ *  \brief Printing the page faults of the main process (during the setup and the simulation) and of the
+ *  intervening entities.
+ *
+ *  \param setup resource usage of the main process at the end of the setup
+ */
+static void printPageFaults (struct rusage *setup)
+{
+    struct rusage self, children;
+
+    getrusage (RUSAGE_SELF, &self);
+    getrusage (RUSAGE_CHILDREN, &children);
+    fprintf (stderr, "Page faults (minor/major): main setup %ld/%ld, main run %ld/%ld, entities %ld/%ld\n",
+             setup->ru_minflt, setup->ru_majflt, self.ru_minflt - setup->ru_minflt,
+             self.ru_majflt - setup->ru_majflt, children.ru_minflt, children.ru_majflt);
+}
+
+/**
+ *  \brief Printing the contention counters of the semaphores.
+ *
+ *  For every semaphore on which a <em>down</em> was carried out, the number of acquisitions, how many of them
+ *  blocked and the total and longest time blocked are printed on stderr.
+ *
+ *  \param sh pointer to shared memory region
+ */
+static void printSemStats (SHARED_DATA *sh)
+{
+    char name[100];
+    unsigned int s;
+
+    fprintf (stderr, "Semaphore contention:\n");
+    fprintf (stderr, "%3s %-28s %8s %8s %7s %12s %10s\n",
+             "", "", "downs", "blocked", "(%)", "total (ms)", "max (ms)");
+    for (s = 1; s <= SEM_NU; s++) {
+        SEM_STATS *st = &sh->semStats[s];
+
+        if (st->acquisitions == 0)
+            continue;
+        get_semaphore_name (&sh->fSt, s, name, sizeof (name));
+        fprintf (stderr, "%3u %-28s %8lu %8lu %7.1f %12.3f %10.3f\n", s, name, st->acquisitions, st->blocked,
+                 100.0 * st->blocked / st->acquisitions, st->blockedTime / 1e6, st->maxBlockedTime / 1e6);
+    }
+}
+
+/**
+ *  \brief Checking if all groups have terminated.
+ */
+static bool groupsGone (SHARED_DATA *sh)
+{
+    int g;
+
+    for (g = 0; g < sh->fSt.nGroups; g++)
+        if (!__atomic_load_n (&sh->wfg.node[g].exited, __ATOMIC_ACQUIRE))
+            return false;
+    return true;
+}
+
+/**
+ *  \brief Checking if every live entity is blocked on a semaphore.
+ *
+ *  An entity sleeping (eating, cooking, arriving or backing off) or in a timed down is not blocked: it will
+ *  make progress on its own, however long it takes.
+ */
+static bool allBlocked (SHARED_DATA *sh)
+{
+    int n;
+
+    for (n = 0; n < WFG_NODES; n++) {
+        if ((n >= sh->fSt.nGroups) && (n < WFG_CHEF))
+            continue;
+        if (!__atomic_load_n (&sh->wfg.node[n].exited, __ATOMIC_ACQUIRE) &&
+            (__atomic_load_n (&sh->wfg.node[n].blockedOn, __ATOMIC_ACQUIRE) == 0))
+            return false;
+    }
+    return true;
+}
+
+/**
+ *  \brief Stopping the chef, the waiter and the receptionist once the groups have terminated (daemon mode).
+ *
+ *  The waiter and the receptionist get a <tt>DRAINREQ</tt> through their request channels and the chef gets an
+ *  order for no group.
+ */
+static void drainServers (SHARED_DATA *sh, int semgid)
+{
+    if ((SEMDOWN (semgid, sh->receptionistRequestPossible) == -1) ||
+        ((sh->fSt.receptionistRequest = (request) { DRAINREQ, -1 }), SEMUP (semgid, sh->receptionistReq) == -1) ||
+        (SEMDOWN (semgid, sh->waiterRequestPossible) == -1) ||
+        ((sh->fSt.waiterRequest = (request) { DRAINREQ, -1 }), SEMUP (semgid, sh->waiterRequest) == -1) ||
+        ((sh->fSt.foodGroup = -1), SEMUP (semgid, sh->waitOrder) == -1) ||
+        (SEMDOWN (semgid, sh->orderReceived) == -1)) {
+        perror ("error on sending the drain requests");
+        exit (EXIT_FAILURE);
+    }
+}
+
+/**
+ *  \brief Waiting for the termination of the intervening entities processes while watching their progress.
+ *
+ *  Progress is signalled by the state transitions counter kept in the shared region and by any change in the
+ *  state of the entities. The function returns as soon as every entity has terminated, since it is woken up
+ *  by <tt>SIGCHLD</tt>, when a deadlock is found in the wait-for graph (entities that suspect one raise
+ *  <tt>SIGUSR1</tt>) or when no progress was made for <tt>stallTime</tt> milliseconds while every live entity
+ *  is blocked on a semaphore (a wake-up was lost).
+ *
+ *  In daemon mode the arrivals taken by the groups are drawn again, the restaurant is drained <tt>runTime</tt>
+ *  seconds after the call or when <tt>SIGINT</tt> or <tt>SIGTERM</tt> is received, and the remaining entities are
+ *  stopped once the groups have terminated (which they also do when the workload has no more arrivals).
+ *
+ *  \param sh pointer to shared memory region
+ *  \param semgid semaphore set identifier
+ *  \param nEnt number of intervening entities processes
+ *  \param stallTime maximum time without progress while every entity is blocked (in milliseconds)
+ *  \param sigs signal set holding <tt>SIGCHLD</tt> and <tt>SIGUSR1</tt> (and <tt>SIGINT</tt> and <tt>SIGTERM</tt>
+ *         in daemon mode), which must be blocked
+ *  \param compress if the spool file of the log should be drained into the compressed logging file meanwhile
+ *  \param runTime time before the restaurant is drained in daemon mode (in seconds, 0 to wait for a signal)
+ *
+ *  \return number of processes that have terminated
+ */
+static unsigned int watchProgress (SHARED_DATA *sh, int semgid, unsigned int nEnt, long stallTime,
+                                   const sigset_t *sigs, bool compress, long runTime)
+{
+    unsigned int m = 0;                                                              /* terminated processes */
+    unsigned long progress = __atomic_load_n (&sh->progress, __ATOMIC_ACQUIRE);    /* last progress counter */
+    FULL_STAT fSt;                                                        /* snapshot of the full state */
+    STAT st;                                                                   /* last state of the entities */
+    struct timespec period = { WATCHDOGPERIOD / 1000, (WATCHDOGPERIOD % 1000) * 1000000L },
+                    confirm = { 0, CONFIRMPERIOD * 1000L },
+                    lastProgress, now, start;
+    int info, status, sig = 0;
+    bool stopped = false;                                       /* drain requests sent (daemon mode) */
+
+    stateSnapshot (sh, &fSt);
+    st = fSt.st;
+    clock_gettime (CLOCK_MONOTONIC, &lastProgress);
+    start = lastProgress;
+    while (true) {
+        while ((info = waitpid (-1, &status, WNOHANG)) > 0) {
+            setExited (sh, info);
+            m += 1;
+        }
+        if (m >= nEnt)
+            return m;
+        if ((info == -1) && (errno != ECHILD)) {
+            perror ("error on waiting for an intervening process");
+            exit (EXIT_FAILURE);
+        }
+
+        if (sh->daemon && !stopped) {
+            workloadFill (&sh->arrivals);
+            clock_gettime (CLOCK_MONOTONIC, &now);
+            if ((sig == SIGINT) || (sig == SIGTERM) ||
+                ((runTime > 0) && ((now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000
+                                   >= runTime * 1000)))
+                __atomic_store_n (&sh->draining, true, __ATOMIC_RELEASE);
+            if ((__atomic_load_n (&sh->draining, __ATOMIC_ACQUIRE) || sh->arrivals.end) && groupsGone (sh)) {
+                drainServers (sh, semgid);
+                stopped = true;
+            }
+        }
+
+        if (wfgConfirm (&sh->wfg, sh->fSt.nGroups, semgid) > 0)
+            return m;
+
+        if (compress)
+            logCompressDrain (&sh->logCursor);
+
+        clock_gettime (CLOCK_MONOTONIC, &now);
+        stateSnapshot (sh, &fSt);
+        if ((__atomic_load_n (&sh->progress, __ATOMIC_ACQUIRE) != progress) ||
+            (memcmp (&st, &fSt.st, sizeof (STAT)) != 0)) {
+            progress = __atomic_load_n (&sh->progress, __ATOMIC_ACQUIRE);
+            st = fSt.st;
+            lastProgress = now;
+        }
+        else if (!allBlocked (sh))
+            lastProgress = now;
+        else if ((now.tv_sec - lastProgress.tv_sec) * 1000 + (now.tv_nsec - lastProgress.tv_nsec) / 1000000
+                 >= stallTime)
+            return m;
+
+        sig = sigtimedwait (sigs, NULL, (wfgFindDeadlock (&sh->wfg, sh->fSt.nGroups, NULL) > 0) ? &confirm : &period);
+    }
+}
 
 /**
  *  \brief Main program.
@@ -55,6 +442,10 @@
 int main (int argc, char *argv[])
 {
     char nFic[51];                                                                              /*name of logging file */
+    char nFicGz[51] = "";                                                               /* name of compressed log file */
+    char nFicTrace[TRACE_NAMELEN] = "";                                                       /* name of trace file */
+    char nFicHist[51] = "";                                                               /* name of histogram file */
+    char nFicRec[RECORD_NAMELEN] = "";                                                       /* name of record file */
     char nFicErr[] = "error_        ";                                                     /* base name of error files */
     int shmid,                                                                      /* shared memory access identifier */
         semgid;                                                                     /* semaphore set access identifier */
@@ -70,12 +461,146 @@ int main (int argc, char *argv[])
         info;                                                                                               /* info id */
     int g, t;
     int ret = EXIT_SUCCESS;
+    long stallTime = STALLTIME;                                  /* time without progress before giving up (ms) */
+    char *tinp;                                                               /* numerical parameters test flag */
+    int opt;
+    char *subopts, *value;                                                  /* memory options being parsed */
+    char *const memTokens[] = { "huge", "prefault", "lock", "memfd", NULL };               /* memory options */
+    bool huge = false, prefault = false, lock = false, memfd = false;  /* options of the shared memory region */
+    bool deltaLog = false;                                         /* log only what each transition changes */
+    bool logMapped = false;                                             /* logging file memory mapped */
+    bool compress = false;                                                   /* logging file compressed */
+    bool shards = false;                                                  /* one logging file per entity */
+    char *workload = NULL;                                              /* description of the workload */
+    FULL_STAT wl;                                        /* groups of the workload, loaded before any IPC */
+    long runTime = -1;                               /* daemon mode: seconds before draining (-1: single batch) */
+    struct timespec runStart, runEnd;                                 /* duration of the simulation */
+    char *const admitTokens[] = { "queue", "wait", "backoff", NULL };           /* admission options */
+    long admit[3] = { 0, 0, ADMITBACKOFF };              /* admission limits and back-off (0: unlimited) */
+    bool admission = false;                                                   /* admission control */
+    bool verbose = false;                                                 /* reports printed at exit */
+    long stations = 1;                                          /* orders cooked by the chef at the same time */
+    struct rusage setup;                                              /* resource usage at the end of setup */
+    sigset_t sigs, oldMask;                                     /* SIGCHLD and SIGUSR1 set and original mask */
 
-    /* getting log file name */
-    if(argc==2) {
-        strcpy(nFic, argv[1]);
+    /* getting options and log file name */
+    while ((opt = getopt (argc, argv, "s:T:H:R:M:dmzSW:D:A:C:v")) != -1) {
+        switch (opt) {
+            case 's':
+                stallTime = strtol (optarg, &tinp, 0);
+                if ((*tinp != '\0') || (stallTime <= 0)) {
+                    fprintf (stderr, "Stall time must be a positive number of milliseconds!\n");
+                    exit (EXIT_FAILURE);
+                }
+                break;
+            case 'T':
+                if (strlen (optarg) >= TRACE_NAMELEN) {
+                    fprintf (stderr, "Trace file name is too long!\n");
+                    exit (EXIT_FAILURE);
+                }
+                strcpy (nFicTrace, optarg);
+                break;
+            case 'H':
+                if (strlen (optarg) >= sizeof (nFicHist)) {
+                    fprintf (stderr, "Histogram file name is too long!\n");
+                    exit (EXIT_FAILURE);
+                }
+                strcpy (nFicHist, optarg);
+                break;
+            case 'M':
+                subopts = optarg;
+                while (*subopts != '\0')
+                    switch (getsubopt (&subopts, memTokens, &value)) {
+                        case 0: huge = true; break;
+                        case 1: prefault = true; break;
+                        case 2: lock = prefault = true; break;
+                        case 3: memfd = true; break;
+                        default:
+                            fprintf (stderr, "Memory options must be huge, prefault, lock or memfd!\n");
+                            exit (EXIT_FAILURE);
+                    }
+                break;
+            case 'R':
+                if (strlen (optarg) >= sizeof (nFicRec)) {
+                    fprintf (stderr, "Record file name is too long!\n");
+                    exit (EXIT_FAILURE);
+                }
+                strcpy (nFicRec, optarg);
+                break;
+            case 'v':
+                verbose = true;
+                break;
+            case 'd':
+                deltaLog = true;
+                break;
+            case 'm':
+                logMapped = true;
+                break;
+            case 'z':
+                compress = logMapped = true;
+                break;
+            case 'S':
+                shards = true;
+                break;
+            case 'W':
+                workload = optarg;
+                break;
+            case 'A':
+                subopts = optarg;
+                while (*subopts != '\0') {
+                    opt = getsubopt (&subopts, admitTokens, &value);
+                    if ((opt == -1) || (value == NULL) || ((admit[opt] = strtol (value, &tinp, 0)) <= 0) ||
+                        (*tinp != '\0') || (admit[opt] > INT_MAX)) {
+                        fprintf (stderr, "Admission options must be queue, wait or backoff with a positive value!\n");
+                        exit (EXIT_FAILURE);
+                    }
+                }
+                admission = true;
+                break;
+            case 'C':
+                stations = strtol (optarg, &tinp, 0);
+                if ((*tinp != '\0') || (stations < 1) || (stations > NUMTABLES)) {
+                    fprintf (stderr, "Number of stations must be between 1 and NUMTABLES!\n");
+                    exit (EXIT_FAILURE);
+                }
+                break;
+            case 'D':
+                runTime = strtol (optarg, &tinp, 0);
+                if ((*tinp != '\0') || (runTime < 0)) {
+                    fprintf (stderr, "Run time must be a non negative number of seconds!\n");
+                    exit (EXIT_FAILURE);
+                }
+                break;
+            default:
+                fprintf (stderr, "Usage: %s [-s stallTime] [-T traceFile] [-H histFile] [-R recFile] [-v] [-M memOptions] [-d] [-m] [-z] [-S] [-W workload] [-D runTime] [-A admission] [-C stations] [logFile]\n", argv[0]);
+                exit (EXIT_FAILURE);
+        }
+    }
+    if (optind < argc) {
+        strcpy(nFic, argv[optind]);
     }
     else strcpy(nFic, "");
+    if (logMapped && (strlen (nFic) == 0)) {
+        fprintf (stderr, "The standard output can not be memory mapped: a logging file must be given!\n");
+        exit (EXIT_FAILURE);
+    }
+    if (shards && ((strlen (nFic) == 0) || logMapped)) {
+        fprintf (stderr, "Sharded logging needs a logging file that is not memory mapped!\n");
+        exit (EXIT_FAILURE);
+    }
+    if (compress) {
+        /* the entities log to the spool file, which is drained into the logging file */
+        strcpy (nFicGz, nFic);
+        if (access ("/dev/shm", W_OK) == 0)
+            sprintf (nFic, "/dev/shm/restaurantLog.%d", getpid ());
+        else if (snprintf (nFic, sizeof (nFic), "%s.spool", nFicGz) >= (int) sizeof (nFic)) {
+            fprintf (stderr, "Logging file name is too long!\n");
+            exit (EXIT_FAILURE);
+        }
+    }
+
+    /* load the workload (config.txt by default) */
+    workloadLoad (workload, &wl);
 
     /* composing command line */
     if ((key = ftok (".", 'a')) == -1) {
@@ -85,7 +610,12 @@ int main (int argc, char *argv[])
     sprintf (num[1], "%d", key);
 
     /* creating and initializing the shared memory region and the log file */
-    if ((shmid = shmemCreate (key, sizeof (SHARED_DATA))) == -1) { 
+    if (memfd)
+        shmid = shmemCreateFd (sizeof (SHARED_DATA), huge, &huge);
+    else if (huge)
+        shmid = shmemCreateHuge (key, sizeof (SHARED_DATA), &huge);
+    else shmid = shmemCreate (key, sizeof (SHARED_DATA));
+    if (shmid == -1) { 
         perror ("error on creating the shared memory region");
         exit (EXIT_FAILURE);
     }
@@ -93,6 +623,11 @@ int main (int argc, char *argv[])
         perror ("error on mapping the shared region on the process address space");
         exit (EXIT_FAILURE);
     }
+    if (prefault)
+        shmemPrefault (sh, sizeof (SHARED_DATA), true);
+    if (lock && (shmemLock (sh, sizeof (SHARED_DATA)) == -1))
+        perror ("warning: the shared memory region could not be locked in memory");
+    sh->prefault = prefault;
 
     /* initialize random generator */
     srandom ((unsigned int) getpid ());                                
@@ -102,28 +637,48 @@ int main (int argc, char *argv[])
     sh->fSt.st.waiterStat       = WAIT_FOR_REQUEST;                /* the waiter waits for a request */
     sh->fSt.st.receptionistStat = WAIT_FOR_REQUEST;          /* the receptionist waits for a request */
     for (g = 0; g < MAXGROUPS; g++) {
-        sh->fSt.st.groupStat[g] = GOTOREST;                                /* groups are initialized */
-        sh->fSt.assignedTable[g] = -1;                                     /* groups are initialized */
+        GROUPSTAT (sh->fSt.st, g) = GOTOREST;                              /* groups are initialized */
+        GROUPTABLE (sh->fSt, g) = -1;                                      /* groups are initialized */
+        sh->loggedTable[g] = -1;                                  /* as in the first state line of the log */
     }
+    sh->deltaLog = deltaLog;
+    sh->daemon = (runTime >= 0);
+    sh->admitQueue = (int) admit[0];
+    sh->admitWait = admit[1];
+    sh->admitBackoff = admit[2];
+    sh->chefStations = (int) stations;
+    strcpy (sh->recFile, nFicRec);
     sh->fSt.groupsWaiting=0;
+    sh->wfg.mutexHolder = -1;                                       /* nobody holds the mutex */
 
-    FILE *fp = fopen("config.txt","r");
-    if(fp==NULL) {
-        perror("Could not open config file");
-        exit(EXIT_FAILURE);
-    }
-
-    /* parse config file */
-    fscanf(fp,"%*[^\n]");
-    fscanf(fp,"%d ",&sh->fSt.nGroups);
-    fscanf(fp,"%*[^\n]");
-    for(g=0;g < sh->fSt.nGroups;g++) {
-       fscanf(fp,"%d %d", &sh->fSt.startTime[g], &sh->fSt.eatTime[g]);
+    sh->fSt.nGroups = wl.nGroups;
+    for (g = 0; g < wl.nGroups; g++) {
+        GROUPSTART (sh->fSt, g) = GROUPSTART (wl, g);
+        GROUPEAT (sh->fSt, g) = GROUPEAT (wl, g);
     }
+    if (sh->daemon)
+        workloadQueueInit (&sh->arrivals);
    
     /* create log file */
     createLog (nFic, &sh->fSt);                                  
     saveState(nFic,&sh->fSt);
+#ifdef STATELOCKS
+    logQueueInit (&sh->logQueue, &sh->fSt, deltaLog);
+#endif
+    if (logMapped) {
+        sh->logMapped = true;
+        logMapCreate (nFic, &sh->logCursor);
+        if (compress)
+            logCompressOpen (nFic, nFicGz);
+    }
+    if (shards) {
+        sh->logSeq = 1;                                            /* line 0 is the one written above */
+        sh->logShards = true;
+    }
+
+    /* create trace file */
+    strcpy (sh->traceFile, nFicTrace);
+    traceCreate (nFicTrace);
 
     /* initialize semaphore ids */
     sh->mutex                       = MUTEX;                                /* mutual exclusion semaphore id */
@@ -163,7 +718,20 @@ int main (int argc, char *argv[])
         exit (EXIT_FAILURE);
     }
 
+    /* SIGCHLD and SIGUSR1 are kept pending so that the watchdog is woken up when an entity terminates or
+       suspects a deadlock, and so are SIGINT and SIGTERM in daemon mode, which start the drain */
+    sigemptyset (&sigs);
+    sigaddset (&sigs, SIGCHLD);
+    sigaddset (&sigs, SIGUSR1);
+    if (sh->daemon) {
+        sigaddset (&sigs, SIGINT);
+        sigaddset (&sigs, SIGTERM);
+    }
+    sigprocmask (SIG_BLOCK, &sigs, &oldMask);
+    getrusage (RUSAGE_SELF, &setup);
+
     /* generation of intervening entities processes */                            
+    clock_gettime (CLOCK_MONOTONIC, &sh->arrivals.start);                  /* origin of the arrivals (daemon mode) */
     /* group processes */
     strcpy (nFicErr + 6, "GR");
     for (g = 0; g < sh->fSt.nGroups; g++) {           
@@ -173,11 +741,16 @@ int main (int argc, char *argv[])
         }
         sprintf(num[0],"%d",g);
         sprintf(nFicErr+8,"%02d",g); 
-        if (pidGR[g] == 0)
+        if (pidGR[g] == 0) {
+            sigprocmask (SIG_SETMASK, &oldMask, NULL);
+            if (sh->daemon)
+                signal (SIGINT, SIG_IGN);              /* the drain is started by the main process */
             if (execl (GROUP, GROUP, num[0], nFic, num[1], nFicErr, NULL) < 0) { 
                 perror ("error on the generation of the group process");
                 exit (EXIT_FAILURE);
             }
+        }
+        sh->wfg.node[g].pid = pidGR[g];
 #ifdef SEMDEBUG
         sh->debug.groups[g].pid = pidGR[g];
 #endif
@@ -189,12 +762,16 @@ int main (int argc, char *argv[])
         exit (EXIT_FAILURE);
     }
     if (pidWT == 0) {
+        sigprocmask (SIG_SETMASK, &oldMask, NULL);
+        if (sh->daemon)
+            signal (SIGINT, SIG_IGN);                  /* the drain is started by the main process */
         if (execl (WAITER, WAITER, nFic, num[1], nFicErr, NULL) < 0) {
             perror ("error on the generation of the waiter process");
             exit (EXIT_FAILURE);
         }
     }
 
+    sh->wfg.node[WFG_WAITER].pid = pidWT;
 #ifdef SEMDEBUG
     sh->debug.waiter.pid = pidWT;
 #endif
@@ -204,11 +781,16 @@ int main (int argc, char *argv[])
         perror ("error on the fork operation for the chef");
         exit (EXIT_FAILURE);
     }
-    if (pidCH == 0)
+    if (pidCH == 0) {
+        sigprocmask (SIG_SETMASK, &oldMask, NULL);
+        if (sh->daemon)
+            signal (SIGINT, SIG_IGN);                  /* the drain is started by the main process */
         if (execl (CHEF, CHEF, nFic, num[1], nFicErr, NULL) < 0) { 
             perror ("error on the generation of the chef process");
             exit (EXIT_FAILURE);
         }
+    }
+    sh->wfg.node[WFG_CHEF].pid = pidCH;
 #ifdef SEMDEBUG
     sh->debug.chef.pid = pidCH;
 #endif
@@ -219,28 +801,20 @@ int main (int argc, char *argv[])
         perror ("error on the fork operation for the chef");
         exit (EXIT_FAILURE);
     }
-    if (pidRT == 0)
+    if (pidRT == 0) {
+        sigprocmask (SIG_SETMASK, &oldMask, NULL);
+        if (sh->daemon)
+            signal (SIGINT, SIG_IGN);                  /* the drain is started by the main process */
         if (execl (RECEPTIONIST, RECEPTIONIST, nFic, num[1], nFicErr, NULL) < 0) { 
             perror ("error on the generation of the receptionist process");
             exit (EXIT_FAILURE);
         }
+    }
 
+    sh->wfg.node[WFG_RECEPTIONIST].pid = pidRT;
 #ifdef SEMDEBUG
     sh->debug.receptionist.pid = pidRT;
 #endif
-    
-
-    /* Timer process */
-    int pidTimer = fork();
-    if (pidTimer < 0) {
-        perror ("error on the generation of the timer process");
-        exit (EXIT_FAILURE);
-    }
-    
-    if (pidTimer == 0) {
-        sleep(5);
-        exit (EXIT_SUCCESS);
-    }
 
     /* signaling start of operations */
     if (semSignal (semgid) == -1) {
@@ -249,31 +823,58 @@ int main (int argc, char *argv[])
     }
 
     /* waiting for the termination of the intervening entities processes */
-    m = 0;
-    do {
-        info = wait (&status);
-        if (info == -1) { 
-            perror ("error on aiting for an intervening process");
-            exit (EXIT_FAILURE);
-        } else if (info == pidTimer) {
+    clock_gettime (CLOCK_MONOTONIC, &runStart);
+    m = watchProgress (sh, semgid, 3+sh->fSt.nGroups, stallTime, &sigs, compress, runTime);
+    clock_gettime (CLOCK_MONOTONIC, &runEnd);
+    if (m < 3+sh->fSt.nGroups) {
+        /* We're in a deadlock. */
+        if (wfgFindDeadlock (&sh->wfg, sh->fSt.nGroups, NULL) > 0) {
+            fprintf (stderr, "Deadlock detected in the wait-for graph.\n");
+            printWaitFor (sh);
+        }
+        else fprintf (stderr, "No progress for %ld ms: the simulation is deadlocked.\n", stallTime);
 #ifdef SEMDEBUG
-            /* We're in a deadlock. */
-            semdebug_print_deadlock(&sh->debug, &sh->fSt, semgid);
-            
-            kill(pidCH, SIGTERM);
-            kill(pidWT, SIGTERM);
-            kill(pidRT, SIGTERM);
-            for (int i = 0; i < sh->fSt.nGroups; i++)
-                kill(pidGR[i], SIGTERM);
-
-            ret = EXIT_FAILURE;
-            break;
+        FULL_STAT fSt;                              /* the mutex may be held by a deadlocked entity: no locking */
+
+        stateSnapshot (sh, &fSt);
+        semdebug_print_deadlock(&sh->debug, &fSt, semgid);
 #endif
-        }
-        m += 1;
-    } while (m < 3+sh->fSt.nGroups);
-    
-    kill(pidTimer, SIGTERM);
+        kill(pidCH, SIGTERM);
+        kill(pidWT, SIGTERM);
+        kill(pidRT, SIGTERM);
+        for (g = 0; g < sh->fSt.nGroups; g++)
+            kill(pidGR[g], SIGTERM);
+        do {
+            info = wait (&status);
+            m += 1;
+        } while ((info != -1) && (m < 3+sh->fSt.nGroups));
+
+        ret = EXIT_FAILURE;
+    }
+
+    if (logMapped)
+        logMapClose (nFic, &sh->logCursor);
+    if (compress)
+        logCompressClose (&sh->logCursor);
+    traceFinish (nFicTrace);
+    printStateTimes (sh, nFicHist, verbose);
+    if (verbose) {
+        printGroupTimes (sh);
+        printSemStats (sh);
+    }
+    if (admission)
+        fprintf (stderr, "Admission control: %lu table requests turned away\n", sh->turnedAwayCount);
+    if (sh->daemon) {
+        double elapsed = (runEnd.tv_sec - runStart.tv_sec) + (runEnd.tv_nsec - runStart.tv_nsec) / 1e9;
+
+        fprintf (stderr, "Daemon mode: %lu visits in %.3f s (%.2f visits/s)\n", sh->visits, elapsed,
+                 (elapsed > 0.0) ? sh->visits / elapsed : 0.0);
+    }
+    if (huge || prefault || memfd)
+        fprintf (stderr, "Shared memory region: %s, %s pages%s%s\n", memfd ? "memfd" : "System V",
+                 huge ? "huge" : "normal", prefault ? ", pre-faulted" : "", lock ? ", locked" : "");
+    if (verbose || huge || prefault || memfd)
+        printPageFaults (&setup);
 
     /* destruction of semaphore set and shared region */
     if (semDestroy (semgid) == -1) {
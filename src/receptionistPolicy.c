@@ -0,0 +1,225 @@
+/**
+ *  \file receptionistPolicy.c (implementation file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  Table assignment policy of the receptionist.
+ *
+ *  Tables are handed out round-robin, starting after the last one occupied, and the waiting room is served
+ *  in order of arrival.
+ *
+ *  Defined operations:
+ *     \li initialization
+ *     \li decision of the table to occupy (or to wait)
+ *     \li occupation and vacation of a table
+ *     \li placing a group in the waiting room
+ *     \li decision of the group that occupies a vacant table
+ *     \li prediction of the wait of a new group.
+ */
+
+#include <string.h>
+
+#include "probConst.h"
+#include "receptionistPolicy.h"
+
+/**
+ *  \brief Initialization: all tables vacant and nobody waiting.
+ *
+ *  \param p policy state
+ */
+void policyInit (POLICY *p)
+{
+    memset (p, 0, sizeof (POLICY));
+}
+
+/**
+ *  \brief Decision of the table to be occupied by group <tt>n</tt>, or if it must wait.
+ *
+ *  \param p policy state
+ *  \param n group id
+ *
+ *  \return table id or -1 (in case of wait decision)
+ */
+int decideTableOrWait (POLICY *p, int n)
+{
+    int i, t;
+
+    if (p->nOccupied == NUMTABLES)
+        return -1;
+
+    for (i = 0; i < NUMTABLES; i++) {
+        t = (i + p->nextTable) % NUMTABLES;
+        if (!(p->status & (1 << t)))
+            return t;
+    }
+
+    return -1;
+}
+
+/**
+ *  \brief Occupation or vacation of a table.
+ *
+ *  \param p policy state
+ *  \param t table id
+ *  \param occupied <tt>true</tt> if the table becomes occupied, <tt>false</tt> if it becomes vacant
+ */
+void setTableOccupied (POLICY *p, int t, bool occupied)
+{
+    if (occupied) {
+        p->status |= (1 << t);
+        p->nOccupied += 1;
+        p->nextTable = (t + 1) % NUMTABLES;
+    }
+    else {
+        p->status &= ~(1 << t);
+        p->nOccupied -= 1;
+    }
+}
+
+/**
+ *  \brief Placing group <tt>n</tt> in the waiting room.
+ *
+ *  \param p policy state
+ *  \param n group id
+ */
+void addToWaitingRoom (POLICY *p, int n)
+{
+    p->waitlist[p->listEnd] = n;
+    p->listEnd = (p->listEnd + 1) % MAXGROUPS;
+    p->nWaiting += 1;
+}
+
+/**
+ *  \brief Decision of the group (if any) that occupies a table that became vacant.
+ *
+ *  The group leaves the waiting room.
+ *
+ *  \param p policy state
+ *
+ *  \return group id or -1 (in case nobody is waiting)
+ */
+int decideNextGroup (POLICY *p)
+{
+    int g = -1;
+
+    if (p->nWaiting > 0) {
+        g = p->waitlist[p->listBegin];
+        p->listBegin = (p->listBegin + 1) % MAXGROUPS;
+        p->nWaiting -= 1;
+    }
+
+    return g;
+}
+
+/**
+ *  \brief Moving table <tt>t</tt> to its place in the heap after its time changed.
+ */
+static void setFreeAt (WAIT_PREDICTOR *w, int t, long freeAt)
+{
+    int i = w->pos[t], j;
+
+    w->freeAt[t] = freeAt;
+    while ((i > 0) && (w->freeAt[w->heap[(i - 1) / 2]] > freeAt)) {               /* up */
+        w->heap[i] = w->heap[(i - 1) / 2];
+        w->pos[w->heap[i]] = i;
+        i = (i - 1) / 2;
+    }
+    while ((j = 2 * i + 1) < NUMTABLES) {                                                      /* down */
+        if ((j + 1 < NUMTABLES) && (w->freeAt[w->heap[j + 1]] < w->freeAt[w->heap[j]]))
+            j += 1;
+        if (w->freeAt[w->heap[j]] >= freeAt)
+            break;
+        w->heap[i] = w->heap[j];
+        w->pos[w->heap[i]] = i;
+        i = j;
+    }
+    w->heap[i] = t;
+    w->pos[t] = i;
+}
+
+/**
+ *  \brief Initialization of the wait predictor: all tables vacant.
+ *
+ *  \param w wait predictor
+ */
+void predictorInit (WAIT_PREDICTOR *w)
+{
+    int t, g;
+
+    for (t = 0; t < NUMTABLES; t++) {
+        w->freeAt[t] = w->leaveAt[t] = 0;
+        w->heap[t] = w->pos[t] = t;
+    }
+    for (g = 0; g < MAXGROUPS; g++)
+        w->predicted[g] = -1;
+}
+
+/**
+ *  \brief Prediction update when group <tt>g</tt> is seated at table <tt>t</tt>.
+ *
+ *  \param w wait predictor
+ *  \param t table id
+ *  \param g group id
+ *  \param eat eating time of the group
+ *  \param now current time
+ */
+void predictSeated (WAIT_PREDICTOR *w, int t, int g, long eat, long now)
+{
+    /* the group was counted on the table it was predicted to take */
+    if (w->predicted[g] != -1) {
+        setFreeAt (w, w->predicted[g], w->freeAt[w->predicted[g]] - eat);
+        w->predicted[g] = -1;
+    }
+    setFreeAt (w, t, ((w->freeAt[t] > now) ? w->freeAt[t] : now) + eat);
+    w->leaveAt[t] = now + eat;
+}
+
+/**
+ *  \brief Prediction update when table <tt>t</tt> is vacated.
+ *
+ *  The groups predicted to take the table after it are shifted by the error of the prediction.
+ *
+ *  \param w wait predictor
+ *  \param t table id
+ *  \param now current time
+ */
+void predictVacated (WAIT_PREDICTOR *w, int t, long now)
+{
+    setFreeAt (w, t, w->freeAt[t] + (now - w->leaveAt[t]));
+    w->leaveAt[t] = now;
+}
+
+/**
+ *  \brief Prediction update when group <tt>g</tt> joins the waiting room.
+ *
+ *  The group is predicted to take the table that is free first, after the groups already waiting.
+ *
+ *  \param w wait predictor
+ *  \param g group id
+ *  \param eat eating time of the group
+ *  \param now current time
+ *
+ *  \return expected wait of the group
+ */
+long predictJoin (WAIT_PREDICTOR *w, int g, long eat, long now)
+{
+    int t = w->heap[0];
+    long wait = predictWait (w, now);
+
+    w->predicted[g] = t;
+    setFreeAt (w, t, w->freeAt[t] + eat);
+    return wait;
+}
+
+/**
+ *  \brief Expected wait of a group that would join the waiting room now.
+ *
+ *  \param w wait predictor
+ *  \param now current time
+ *
+ *  \return expected wait
+ */
+long predictWait (WAIT_PREDICTOR *w, long now)
+{
+    return (w->freeAt[w->heap[0]] > now) ? w->freeAt[w->heap[0]] - now : 0;
+}
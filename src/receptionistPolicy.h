@@ -0,0 +1,169 @@
+/**
+ *  \file receptionistPolicy.h (interface file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  Table assignment policy of the receptionist.
+ *
+ *  The decisions of the receptionist depend only on its own view of the tables and of the waiting room, kept
+ *  in a <tt>POLICY</tt>, so they can be driven both by the receptionist process and by <tt>replay</tt>, which
+ *  re-runs a recorded sequence of requests in a single process.
+ *
+ *  Defined operations:
+ *     \li initialization
+ *     \li decision of the table to occupy (or to wait)
+ *     \li occupation and vacation of a table
+ *     \li placing a group in the waiting room
+ *     \li decision of the group that occupies a vacant table
+ *     \li prediction of the wait of a new group.
+ *
+ *  The wait predictor keeps, for each table, the time it is predicted to be free for a group that is not yet
+ *  placed: the time its group is predicted to leave (after eating) plus the eating times of the waiting groups
+ *  predicted to take it. The tables are kept in a min-heap of those times, so the expected wait of a new group
+ *  is read in constant time and every update takes O(log NUMTABLES).
+ */
+
+#ifndef RECEPTIONISTPOLICY_H_
+#define RECEPTIONISTPOLICY_H_
+
+#include <stdbool.h>
+
+#include "probConst.h"
+
+/**
+ *  \brief Definition of the receptionist view of the tables and of the waiting room.
+ */
+typedef struct {
+    /** \brief occupied tables (one bit per table) */
+    unsigned int status;
+    /** \brief number of occupied tables */
+    int nOccupied;
+    /** \brief table considered first for the next group */
+    int nextTable;
+    /** \brief groups in the waiting room, in order of arrival (circular list) */
+    int waitlist[MAXGROUPS];
+    /** \brief position of the first waiting group */
+    int listBegin;
+    /** \brief position after the last waiting group */
+    int listEnd;
+    /** \brief number of waiting groups */
+    int nWaiting;
+} POLICY;
+
+/**
+ *  \brief Definition of the wait predictor of the receptionist.
+ *
+ *  Times are in any unit, as long as it is the same in all calls.
+ */
+typedef struct {
+    /** \brief time each table is predicted to be free for a group not yet placed */
+    long freeAt[NUMTABLES];
+    /** \brief time the group seated at each table is predicted to leave */
+    long leaveAt[NUMTABLES];
+    /** \brief tables, as a min-heap of <tt>freeAt</tt> */
+    int heap[NUMTABLES];
+    /** \brief position of each table in the heap */
+    int pos[NUMTABLES];
+    /** \brief table each waiting group is predicted to take (-1 if none) */
+    int predicted[MAXGROUPS];
+} WAIT_PREDICTOR;
+
+/**
+ *  \brief Initialization: all tables vacant and nobody waiting.
+ *
+ *  \param p policy state
+ */
+extern void policyInit (POLICY *p);
+
+/**
+ *  \brief Decision of the table to be occupied by group <tt>n</tt>, or if it must wait.
+ *
+ *  \param p policy state
+ *  \param n group id
+ *
+ *  \return table id or -1 (in case of wait decision)
+ */
+extern int decideTableOrWait (POLICY *p, int n);
+
+/**
+ *  \brief Occupation or vacation of a table.
+ *
+ *  \param p policy state
+ *  \param t table id
+ *  \param occupied <tt>true</tt> if the table becomes occupied, <tt>false</tt> if it becomes vacant
+ */
+extern void setTableOccupied (POLICY *p, int t, bool occupied);
+
+/**
+ *  \brief Placing group <tt>n</tt> in the waiting room.
+ *
+ *  \param p policy state
+ *  \param n group id
+ */
+extern void addToWaitingRoom (POLICY *p, int n);
+
+/**
+ *  \brief Decision of the group (if any) that occupies a table that became vacant.
+ *
+ *  The group leaves the waiting room.
+ *
+ *  \param p policy state
+ *
+ *  \return group id or -1 (in case nobody is waiting)
+ */
+extern int decideNextGroup (POLICY *p);
+
+/**
+ *  \brief Initialization of the wait predictor: all tables vacant.
+ *
+ *  \param w wait predictor
+ */
+extern void predictorInit (WAIT_PREDICTOR *w);
+
+/**
+ *  \brief Prediction update when group <tt>g</tt> is seated at table <tt>t</tt>.
+ *
+ *  \param w wait predictor
+ *  \param t table id
+ *  \param g group id
+ *  \param eat eating time of the group
+ *  \param now current time
+ */
+extern void predictSeated (WAIT_PREDICTOR *w, int t, int g, long eat, long now);
+
+/**
+ *  \brief Prediction update when table <tt>t</tt> is vacated.
+ *
+ *  The groups predicted to take the table after it are shifted by the error of the prediction.
+ *
+ *  \param w wait predictor
+ *  \param t table id
+ *  \param now current time
+ */
+extern void predictVacated (WAIT_PREDICTOR *w, int t, long now);
+
+/**
+ *  \brief Prediction update when group <tt>g</tt> joins the waiting room.
+ *
+ *  The group is predicted to take the table that is free first, after the groups already waiting.
+ *
+ *  \param w wait predictor
+ *  \param g group id
+ *  \param eat eating time of the group
+ *  \param now current time
+ *
+ *  \return expected wait of the group
+ */
+extern long predictJoin (WAIT_PREDICTOR *w, int g, long eat, long now);
+
+/**
+ *  \brief Expected wait of a group that would join the waiting room now.
+ *
+ *  \param w wait predictor
+ *  \param now current time
+ *
+ *  \return expected wait
+ */
+extern long predictWait (WAIT_PREDICTOR *w, long now);
+
+#endif /* RECEPTIONISTPOLICY_H_ */
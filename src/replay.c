@@ -0,0 +1,377 @@
+/**
+ *  \file replay.c (implementation file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  Replay of a recorded run through the table assignment policy of the receptionist.
+ *
+ *  The receptionist writes a <tt>#REQ</tt> line for each request it serves to its record file (see logging.h
+ *  and the <tt>-R</tt> option of <tt>probSemSharedMemRestaurant</tt>), with the time it was served, so the
+ *  record file gives, for each visit of a group to the restaurant, the moment it asks for a table,
+ *  the moment and the table it is assigned and the moment the table is vacated on payment, in the order the
+ *  receptionist took its decisions. Groups may come back (runs with <tt>-D</tt>), so a group may have
+ *  several visits. The arrivals and the time each visit holds its table are then re-driven, in a single
+ *  process and without semaphores or sleeps, through <tt>decideTableOrWait</tt> and <tt>decideNextGroup</tt>
+ *  (see receptionistPolicy.h), exactly as the receptionist does: events are processed in time order, and in
+ *  the recorded order when their times are equal. A group comes back after leaving with the same delay as in
+ *  the recorded run. The resulting waits and table utilization are printed next to the recorded ones.
+ *
+ *  Since the events of the unchanged policy happen at the recorded times and in the recorded order, the replay
+ *  must reproduce the recorded table assignments, which is checked. Admission control is not replayed: the
+ *  first table request of a visit is its arrival, and a run where requests were turned away is not expected
+ *  to be reproduced.
+ *
+ *  The receptionist is the only writer of the record file, so it is the same whatever the logging mode of the
+ *  run. Its <tt>#WAIT</tt> lines are ignored.
+ *
+ *  Upon execution, the following parameters are accepted:
+ *    \li <tt>-r repeats</tt>: number of times the replay is run, to time it (1 by default)
+ *    \li name of the record file (stdin, if absent).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "probConst.h"
+#include "receptionistPolicy.h"
+
+/**
+ *  \brief Definition of the recorded and replayed history of a visit of a group.
+ */
+typedef struct {
+    /** \brief group id */
+    int group;
+    /** \brief next visit of the group (-1 if none) */
+    int next;
+    /** \brief time the group asks for a table (in us) */
+    long arrival;
+    /** \brief time a table is assigned to the group (recorded run) */
+    long seated;
+    /** \brief time the table of the group is vacated (recorded run) */
+    long vacated;
+    /** \brief table occupied (recorded run) */
+    int table;
+    /** \brief place of the arrival and of the payment among the recorded requests */
+    long arrivalOrder, vacatedOrder;
+    /** \brief time the group asks for a table (replay, -1 while the previous visit is not over) */
+    long rArrival;
+    /** \brief if the group asked for a table (replay) */
+    bool rArrived;
+    /** \brief time a table is assigned to the group (replay, -1 while it waits) */
+    long rSeated;
+    /** \brief time the table of the group is vacated (replay) */
+    long rVacated;
+    /** \brief table occupied (replay) */
+    int rTable;
+} VISIT;
+
+/** \brief number of groups (highest group id plus one) */
+static int nGroups = 0;
+
+/** \brief visits, in the order of their arrivals */
+static VISIT *visit = NULL;
+
+/** \brief number of visits */
+static int nVisits = 0;
+
+/** \brief first visit of each group */
+static int firstVisit[MAXGROUPS];
+
+/** \brief number of table requests turned away in the recorded run */
+static long nTurnedAway = 0;
+
+/**
+ *  \brief Reporting an invalid record file and terminating the process.
+ */
+static void recordError (long line, const char *what)
+{
+    fprintf (stderr, "line %ld: %s\n", line, what);
+    exit (EXIT_FAILURE);
+}
+
+/**
+ *  \brief Reading of the recorded run.
+ *
+ *  \param fic record file
+ */
+static void readRecords (FILE *fic)
+{
+    char *line = NULL, kind[10], where[10];
+    size_t size = 0;
+    long lineNo = 0, order = 0, t;
+    int open[MAXGROUPS], last[MAXGROUPS], g, table, size_v = 0;
+    VISIT *v;
+
+    for (g = 0; g < MAXGROUPS; g++)
+        open[g] = last[g] = firstVisit[g] = -1;
+
+    while (getline (&line, &size, fic) != -1) {
+        lineNo += 1;
+        if (strncmp (line, "#REQ ", 5) != 0)
+            continue;
+        if ((sscanf (line, "#REQ %ld %9s G%d %9s", &t, kind, &g, where) != 4) || (g < 0) || (g >= MAXGROUPS))
+            recordError (lineNo, "malformed request record");
+        if (strcmp (where, "wait") == 0)
+            table = -1;
+        else if (strcmp (where, "away") == 0)
+            table = -2;
+        else if ((sscanf (where, "%d", &table) != 1) || (table < 0) || (table >= NUMTABLES))
+            recordError (lineNo, "invalid table");
+        order += 1;
+        if (g >= nGroups)
+            nGroups = g + 1;
+
+        if (strcmp (kind, "TABLE") == 0) {
+            if (open[g] == -1) {                                                                /* new visit */
+                if (nVisits == size_v) {
+                    size_v = (size_v == 0) ? 64 : 2 * size_v;
+                    if ((visit = realloc (visit, size_v * sizeof (VISIT))) == NULL) {
+                        perror ("error on allocating the visits");
+                        exit (EXIT_FAILURE);
+                    }
+                }
+                v = &visit[nVisits];
+                v->group = g;
+                v->next = -1;
+                v->arrival = t;
+                v->arrivalOrder = order;
+                v->seated = v->vacated = -1;
+                v->table = -1;
+                if (last[g] == -1)
+                    firstVisit[g] = nVisits;
+                else visit[last[g]].next = nVisits;
+                last[g] = open[g] = nVisits++;
+            }
+            else if (visit[open[g]].seated != -1)
+                recordError (lineNo, "table request of a seated group");
+            if (table == -2)
+                nTurnedAway += 1;
+            else if (table >= 0) {
+                visit[open[g]].seated = t;
+                visit[open[g]].table = table;
+            }
+        }
+        else if (strcmp (kind, "SEAT") == 0) {
+            if ((open[g] == -1) || (visit[open[g]].seated != -1) || (table < 0))
+                recordError (lineNo, "seating of a group that is not waiting");
+            visit[open[g]].seated = t;
+            visit[open[g]].table = table;
+        }
+        else if (strcmp (kind, "BILL") == 0) {
+            if ((open[g] == -1) || (visit[open[g]].seated == -1) || (visit[open[g]].table != table))
+                recordError (lineNo, "payment of a group that is not seated at the table");
+            visit[open[g]].vacated = t;
+            visit[open[g]].vacatedOrder = order;
+            open[g] = -1;
+        }
+        else recordError (lineNo, "unknown request");
+    }
+    free (line);
+
+    if (nVisits == 0) {
+        fprintf (stderr, "No request records (#REQ) found!\n");
+        exit (EXIT_FAILURE);
+    }
+    for (g = 0; g < nGroups; g++)
+        if (open[g] != -1) {
+            fprintf (stderr, "Group %d does not complete its last visit in the records!\n", g);
+            exit (EXIT_FAILURE);
+        }
+}
+
+/**
+ *  \brief Seating of a visit at a table, in the replay.
+ */
+static void seat (POLICY *p, VISIT *v, int table, long now)
+{
+    setTableOccupied (p, table, true);
+    v->rTable = table;
+    v->rSeated = now;
+    v->rVacated = now + (v->vacated - v->seated);
+}
+
+/**
+ *  \brief Replay of the recorded arrivals through the policy.
+ *
+ *  Each group has at most one pending event, the arrival of its present visit or its payment, so the next
+ *  event is the earliest of the groups, the recorded order breaking ties.
+ *
+ *  \return number of decisions taken
+ */
+static long replay (void)
+{
+    POLICY p;
+    long now = 0, order = 0, t, o, decisions = 0;
+    int cur[MAXGROUPS], g, next, table, done = 0;
+    VISIT *v;
+
+    policyInit (&p);
+    for (next = 0; next < nVisits; next++) {
+        visit[next].rArrival = visit[next].rSeated = visit[next].rVacated = -1;
+        visit[next].rArrived = false;
+        visit[next].rTable = -1;
+    }
+    for (g = 0; g < nGroups; g++)
+        if ((cur[g] = firstVisit[g]) != -1)
+            visit[cur[g]].rArrival = visit[cur[g]].arrival;
+
+    while (done < nVisits) {
+        /* next event */
+        next = -1;
+        for (g = 0; g < nGroups; g++) {
+            if (cur[g] == -1)
+                continue;
+            v = &visit[cur[g]];
+            if (!v->rArrived) {
+                t = v->rArrival;
+                o = v->arrivalOrder;
+            }
+            else if (v->rSeated != -1) {
+                t = v->rVacated;
+                o = v->vacatedOrder;
+            }
+            else continue;                                                               /* in the waiting room */
+            if ((next == -1) || (t < now) || ((t == now) && (o < order))) {
+                next = g;
+                now = t;
+                order = o;
+            }
+        }
+        v = &visit[cur[next]];
+
+        decisions += 1;
+        if (!v->rArrived) {                                                                        /* TABLEREQ */
+            v->rArrived = true;
+            if ((table = decideTableOrWait (&p, next)) > -1)
+                seat (&p, v, table, now);
+            else addToWaitingRoom (&p, next);
+        }
+        else {                                                                                      /* BILLREQ */
+            done += 1;
+            setTableOccupied (&p, v->rTable, false);
+            /* the group comes back after the same delay as in the recorded run */
+            if ((cur[next] = v->next) != -1)
+                visit[cur[next]].rArrival = now + (visit[cur[next]].arrival - v->vacated);
+            if ((g = decideNextGroup (&p)) > -1) {
+                if ((table = decideTableOrWait (&p, g)) > -1)
+                    seat (&p, &visit[cur[g]], table, now);
+                else addToWaitingRoom (&p, g);
+            }
+        }
+    }
+
+    return decisions;
+}
+
+/**
+ *  \brief Printing the waits and the table utilization, recorded and replayed.
+ *
+ *  \return number of visits whose replayed table differs from the recorded one
+ */
+static int printResults (void)
+{
+    long busy[NUMTABLES] = { 0 }, rBusy[NUMTABLES] = { 0 };
+    long wait, rWait, sum = 0, rSum = 0, max = 0, rMax = 0, end = 0, rEnd = 0, start = visit[0].arrival;
+    double gSum[MAXGROUPS] = { 0.0 }, gRSum[MAXGROUPS] = { 0.0 };
+    int gVisits[MAXGROUPS] = { 0 }, i, g, t, differ = 0;
+    VISIT *v;
+
+    for (i = 0; i < nVisits; i++) {
+        v = &visit[i];
+        wait = v->seated - v->arrival;
+        rWait = v->rSeated - v->rArrival;
+        gVisits[v->group] += 1;
+        gSum[v->group] += wait;
+        gRSum[v->group] += rWait;
+        sum += wait;
+        rSum += rWait;
+        if (wait > max) max = wait;
+        if (rWait > rMax) rMax = rWait;
+        if (v->vacated > end) end = v->vacated;
+        if (v->rVacated > rEnd) rEnd = v->rVacated;
+        busy[v->table] += v->vacated - v->seated;
+        rBusy[v->rTable] += v->rVacated - v->rSeated;
+        if ((v->rTable != v->table) || (v->rSeated != v->seated))
+            differ += 1;
+    }
+
+    printf ("%d groups, %d visits, %ld table requests turned away (times in ms)\n\n", nGroups, nVisits, nTurnedAway);
+    printf ("group  visits   mean wait  replayed wait\n");
+    for (g = 0; g < nGroups; g++)
+        if (gVisits[g] > 0)
+            printf ("  %02d  %7d  %10.3f  %13.3f\n", g, gVisits[g], gSum[g] / gVisits[g] / 1e3,
+                    gRSum[g] / gVisits[g] / 1e3);
+    printf ("\n                    recorded  replayed\n");
+    printf ("mean wait         %10.3f%10.3f\n", sum / 1e3 / nVisits, rSum / 1e3 / nVisits);
+    printf ("max wait          %10.3f%10.3f\n", max / 1e3, rMax / 1e3);
+    printf ("last payment      %10.3f%10.3f\n", (end - start) / 1e3, (rEnd - start) / 1e3);
+    for (t = 0; t < NUMTABLES; t++)
+        printf ("table %d in use    %9.1f%%%9.1f%%\n", t,
+                (end > start) ? 100.0 * busy[t] / (end - start) : 0.0,
+                (rEnd > start) ? 100.0 * rBusy[t] / (rEnd - start) : 0.0);
+
+    return differ;
+}
+
+/**
+ *  \brief Main program.
+ *
+ *  Its role is to read the recorded run, replay it, print the results and check that the recorded table
+ *  assignments are reproduced.
+ */
+int main (int argc, char *argv[])
+{
+    FILE *fic = stdin;
+    struct timespec t0, t1;
+    long decisions = 0, r, repeats = 1;
+    double elapsed;
+    char *tinp;
+    int opt, differ;
+
+    while ((opt = getopt (argc, argv, "r:")) != -1)
+        switch (opt) {
+            case 'r':
+                repeats = strtol (optarg, &tinp, 0);
+                if ((*tinp != '\0') || (repeats < 1)) {
+                    fprintf (stderr, "Invalid number of repeats!\n");
+                    exit (EXIT_FAILURE);
+                }
+                break;
+            default:
+                fprintf (stderr, "Usage: %s [-r repeats] [recFile]\n", argv[0]);
+                exit (EXIT_FAILURE);
+        }
+    if ((optind < argc) && ((fic = fopen (argv[optind], "r")) == NULL)) {
+        perror ("error on opening the record file");
+        exit (EXIT_FAILURE);
+    }
+
+    readRecords (fic);
+    if (fic != stdin)
+        fclose (fic);
+
+    clock_gettime (CLOCK_MONOTONIC, &t0);
+    for (r = 0; r < repeats; r++)
+        decisions += replay ();
+    clock_gettime (CLOCK_MONOTONIC, &t1);
+    elapsed = (t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_nsec - t0.tv_nsec) / 1e3;
+
+    differ = printResults ();
+    printf ("\n%ld decisions in %.3f us per replay\n", decisions / repeats, elapsed / repeats);
+
+    if (differ == 0)
+        printf ("the replay reproduces the recorded table assignments\n");
+    else if (nTurnedAway > 0)
+        printf ("%d of %d visits seated differently (requests turned away are not replayed)\n", differ, nVisits);
+    else {
+        printf ("%d of %d visits seated differently: the replay does not reproduce the recorded run!\n",
+                differ, nVisits);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
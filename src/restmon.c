@@ -0,0 +1,243 @@
+/**
+ *  \file restmon.c (implementation file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  Live monitor of a running simulation.
+ *
+ *  The monitor attaches read-only to the shared region of the simulation started in the same directory and
+ *  periodically renders the state of the intervening entities (and the time each group has spent in its
+ *  present state), the occupancy of the tables, the depth of the queues, the values of the semaphores and
+ *  the throughput of the simulation. It never takes <tt>sh->mutex</tt>, so it does not slow the simulation
+ *  down: consistent snapshots of the full state are taken through its sequence counter (with <tt>STATELOCKS</tt>,
+ *  through the sequence counter of each entity, see stateSnapshot).
+ *
+ *  Upon execution, the following parameters are accepted:
+ *    \li <tt>-r rate</tt>: number of samples per second (optional, 2 by default)
+ *    \li <tt>-b</tt>: batch mode, the samples are printed one after the other instead of refreshing the screen
+ *        (optional).
+ *
+ *  The monitor terminates when the simulation does.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "sharedDataSync.h"
+#include "semaphore.h"
+#include "sharedMemory.h"
+
+/** \brief default number of samples per second */
+#define  RATE               2.0
+
+/** \brief pointer to shared memory region */
+static SHARED_DATA *sh;
+
+/** \brief semaphore set access identifier */
+static int semgid;
+
+/**
+ *  \brief Reading the monotonic clock (in s).
+ */
+static double now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ *  \brief Number of groups that have left the restaurant.
+ */
+static int groupsDone (FULL_STAT *fSt)
+{
+    int g, done = 0;
+
+    for (g = 0; g < fSt->nGroups; g++)
+        if (GROUPSTAT (fSt->st, g) == LEAVING)
+            done += 1;
+
+    return done;
+}
+
+/**
+ *  \brief Printing the value and the number of waiting processes of a semaphore.
+ */
+static void printSem (unsigned int sindex)
+{
+    char name[100];
+
+    get_semaphore_name (&sh->fSt, sindex, name, sizeof (name));
+    printf ("  %-28s %5d %5d\n", name, semGetValue (semgid, sindex), semGetWaiting (semgid, sindex));
+}
+
+/**
+ *  \brief Rendering a sample.
+ *
+ *  \param fSt copy of the full state of the problem
+ *  \param elapsed time since the monitor started (in s)
+ *  \param transRate state transitions per second since the previous sample
+ *  \param doneRate groups that left per second since the previous sample
+ */
+static void render (FULL_STAT *fSt, double elapsed, double transRate, double doneRate)
+{
+    int g, t, eating = 0;
+    unsigned long since;                                       /* time when a group entered its state (in ns) */
+    double tNow;                                                                  /* present time (in s) */
+
+    for (g = 0; g < fSt->nGroups; g++)
+        if (GROUPSTAT (fSt->st, g) == EAT)
+            eating += 1;
+
+    printf ("restmon  %.1f s  transitions %lu (%.1f/s)  groups done %d/%d (%.2f/s)\n\n",
+            elapsed, __atomic_load_n (&sh->progress, __ATOMIC_ACQUIRE), transRate,
+            groupsDone (fSt), fSt->nGroups, doneRate);
+
+    printf ("CH %-14s  WT %-14s  RC %-14s", get_chef_stage_label (fSt->st.chefStat),
+            get_waiter_stage_label (fSt->st.waiterStat), get_receptionist_stage_label (fSt->st.receptionistStat));
+    tNow = now ();
+    for (g = 0; g < fSt->nGroups; g++) {
+        printf ("%sG%02d %-14s", (g % 4 == 0) ? "\n" : "  ", g, get_group_stage_label (GROUPSTAT (fSt->st, g)));
+        /* time in the present state, from the statistics of the group */
+        if ((since = __atomic_load_n (&sh->groupStats.since[g], __ATOMIC_RELAXED)) != 0)
+            printf (" %7.3f s", tNow - since / 1e9);
+        else printf (" %9s", "-");
+    }
+    printf ("\n\n");
+
+    printf ("tables:");
+    for (t = 0; t < NUMTABLES; t++) {
+        for (g = 0; g < fSt->nGroups; g++)
+            if (GROUPTABLE (*fSt, g) == t)
+                break;
+        if (g < fSt->nGroups)
+            printf ("  T%d G%02d", t, g);
+        else printf ("  T%d ---", t);
+    }
+    printf ("  (eating %d)\n", eating);
+    printf ("expected waits:");
+    for (g = 0; g < fSt->nGroups; g++)
+        if (GROUPSTAT (fSt->st, g) == ATRECEPTION)
+            printf ("  G%02d %.1f ms", g, sh->expectedWait[g] / 1000.0);
+    printf ("\n");
+    printf ("queues: waiting for table %d  receptionist request %s  waiter request %s  food order %s\n\n",
+            fSt->groupsWaiting, get_request_label (fSt->receptionistRequest.reqType),
+            get_request_label (fSt->waiterRequest.reqType), fSt->foodOrder ? "pending" : "none");
+
+    printf ("  %-28s %5s %5s\n", "semaphore", "value", "ncnt");
+    printSem (sh->mutex);
+    printSem (sh->receptionistReq);
+    printSem (sh->receptionistRequestPossible);
+    printSem (sh->waiterRequest);
+    printSem (sh->waiterRequestPossible);
+    printSem (sh->waitOrder);
+    printSem (sh->orderReceived);
+    for (t = 0; t < NUMTABLES; t++) {
+        printSem (sh->requestReceived[t]);
+        printSem (sh->foodArrived[t]);
+        printSem (sh->tableDone[t]);
+    }
+    for (g = 0; g < fSt->nGroups; g++)
+        if (semGetWaiting (semgid, sh->waitForTable[g]) > 0)
+            printSem (sh->waitForTable[g]);
+}
+
+/**
+ *  \brief Main program.
+ *
+ *  Its role is to attach to the simulation and to render samples of its state until it terminates.
+ */
+int main (int argc, char *argv[])
+{
+    int key, shmid, opt;
+    double rate = RATE, start, last, t;
+    bool batch = false;
+    char *tinp;
+    FULL_STAT fSt;
+    unsigned long lastProgress, progress;
+    int lastDone, done;
+    struct timespec period;
+
+    while ((opt = getopt (argc, argv, "r:b")) != -1) {
+        switch (opt) {
+            case 'r':
+                rate = strtod (optarg, &tinp);
+                if ((*tinp != '\0') || (rate <= 0.0)) {
+                    fprintf (stderr, "Rate must be a positive number of samples per second!\n");
+                    exit (EXIT_FAILURE);
+                }
+                break;
+            case 'b':
+                batch = true;
+                break;
+            default:
+                fprintf (stderr, "Usage: %s [-r rate] [-b]\n", argv[0]);
+                exit (EXIT_FAILURE);
+        }
+    }
+    period.tv_sec = (time_t) (1.0 / rate);
+    period.tv_nsec = (long) ((1.0 / rate - period.tv_sec) * 1e9);
+
+    /* connection to the semaphore set and the shared memory region */
+    if ((key = ftok (".", 'a')) == -1) {
+        perror ("error on generating the key");
+        exit (EXIT_FAILURE);
+    }
+    if ((shmid = shmemConnect (key)) == -1) {
+        perror ("error on connecting to the shared memory region (is the simulation running?)");
+        exit (EXIT_FAILURE);
+    }
+    if (shmemAttachReadOnly (shmid, (void **) &sh) == -1) {
+        perror ("error on mapping the shared region on the process address space");
+        exit (EXIT_FAILURE);
+    }
+    /* waits for the simulation to start */
+    if ((semgid = semConnect (key)) == -1) {
+        perror ("error on connecting to the semaphore set");
+        exit (EXIT_FAILURE);
+    }
+
+    start = last = now ();
+    lastProgress = __atomic_load_n (&sh->progress, __ATOMIC_ACQUIRE);
+    stateSnapshot (sh, &fSt);
+    lastDone = groupsDone (&fSt);
+    for (;;) {
+        /* the semaphore set is destroyed when the simulation terminates */
+        if (semGetValue (semgid, sh->mutex) == -1)
+            break;
+
+        stateSnapshot (sh, &fSt);
+        progress = __atomic_load_n (&sh->progress, __ATOMIC_ACQUIRE);
+        t = now ();
+        done = groupsDone (&fSt);
+
+        if (!batch)
+            printf ("\033[H\033[2J");
+        render (&fSt, t - start, (progress - lastProgress) / (t - last + 1e-9),
+                (done - lastDone) / (t - last + 1e-9));
+        printf ("\n");
+        fflush (stdout);
+
+        lastProgress = progress;
+        lastDone = done;
+        last = t;
+        nanosleep (&period, NULL);
+    }
+
+    printf ("simulation terminated\n");
+    if (shmemDettach (sh) == -1) {
+        perror ("error on unmapping the shared region off the process address space");
+        exit (EXIT_FAILURE);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -4,12 +4,151 @@
 // N.º Mec.: 95316
 
 #include <stdlib.h>
-#include "semaphore.h"
-
-#ifdef SEMDEBUG
+#include <stdbool.h>
+#include <errno.h>
 #include <stdio.h>
+#include <signal.h>
 #include <unistd.h>
+#include "semaphore.h"
 #include "sharedDataSync.h"
+#include "waitForGraph.h"
+#include "trace.h"
+#include "seqlock.h"
+#include "logging.h"
+
+// -*-*- WAIT-FOR GRAPH -*-*-
+
+// Node of this entity in the wait-for graph (see waitForGraph.h).
+static int wfg_self = -1;
+
+void wfg_init(int node)
+{
+    wfg_self = node;
+}
+
+// Which entities are expected to signal each semaphore of the set.
+static unsigned int wfg_signallers(unsigned int index)
+{
+    if (index == sh->mutex)
+        return WFG_BY_HOLDER;
+    if (index == sh->receptionistReq)
+        return WFG_BY_GROUPS;
+    if (index == sh->receptionistRequestPossible)
+        return WFG_BY_RECEPTIONIST;
+    if (index == sh->waiterRequest)
+        return WFG_BY_GROUPS | WFG_BY_CHEF;
+    if (index == sh->waiterRequestPossible || index == sh->waitOrder)
+        return WFG_BY_WAITER;
+    if (index == sh->orderReceived)
+        return WFG_BY_CHEF;
+
+    for (int t = 0; t < NUMTABLES; t++) {
+        if (index == sh->requestReceived[t] || index == sh->foodArrived[t])
+            return WFG_BY_WAITER;
+        if (index == sh->tableDone[t])
+            return WFG_BY_RECEPTIONIST;
+    }
+
+    // waitForTable.
+    return WFG_BY_RECEPTIONIST;
+}
+
+// Must be called right before blocking on a semaphore. The main process is
+// woken up at once if we look like the last entity closing a deadlock.
+static void wfg_before_down(unsigned int index)
+{
+    if (wfgBlock(&sh->wfg, sh->fSt.nGroups, wfg_self, index, wfg_signallers(index)))
+        kill(getppid(), SIGUSR1);
+}
+
+static void wfg_after_down(unsigned int index)
+{
+    wfgUnblock(&sh->wfg, wfg_self);
+    if (index == sh->mutex)
+        __atomic_store_n(&sh->wfg.mutexHolder, wfg_self, __ATOMIC_RELEASE);
+}
+
+static void wfg_before_up(unsigned int index)
+{
+    if (index == sh->mutex)
+        __atomic_store_n(&sh->wfg.mutexHolder, -1, __ATOMIC_RELEASE);
+}
+
+// -*-*- STATE SEQLOCK -*-*-
+
+// The full state is only changed inside the critical region, so the whole region is a write of the seqlock.
+#ifndef STATELOCKS
+
+static bool seq_down(unsigned int index) { return false; }
+static bool seq_up(unsigned int index) { return false; }
+
+static void seq_after_down(unsigned int index)
+{
+    if (index == sh->mutex)
+        seqWriteBegin(&sh->stateSeq);
+}
+
+static void seq_before_up(unsigned int index)
+{
+    if (index == sh->mutex)
+        seqWriteEnd(&sh->stateSeq);
+}
+
+#else
+
+// With STATELOCKS the mutex semaphore is not used at all. Every field changed inside the critical region has
+// a single writer (each entity owns its state word, the waiter the food order and the receptionist the tables,
+// the number of groups waiting and the predicted waits), so the region of an entity is a write of its own
+// seqlock, which never waits for another entity. The order of the log lines is set by the ticket each
+// transition takes in the log queue: the transition only leaves its record there, and the lines are written
+// once the region is left, in the order of the tickets, by whichever entity finds the queue without a writer
+// (see logQueueFlush).
+
+static bool seq_down(unsigned int index)
+{
+    if (index != sh->mutex)
+        return false;
+
+    seqWriteBegin(&sh->entitySeq[wfg_self].val);
+    return true;
+}
+
+static bool seq_up(unsigned int index)
+{
+    if (index != sh->mutex)
+        return false;
+
+    seqWriteEnd(&sh->entitySeq[wfg_self].val);
+    logQueueFlush(nFic, &sh->logQueue);
+    return true;
+}
+
+static void seq_after_down(unsigned int index) {}
+static void seq_before_up(unsigned int index) {}
+
+#endif
+
+// -*-*- TIMELINE TRACE -*-*-
+
+// Name of the semaphore of the pending down, used for both of its events.
+static char trace_sem_name[100];
+
+static void trace_before_down(unsigned int index)
+{
+    if (!traceEnabled())
+        return;
+
+    get_semaphore_name(&sh->fSt, index, trace_sem_name, sizeof(trace_sem_name));
+    traceBegin("semDown", trace_sem_name);
+}
+
+static void trace_after_down(void)
+{
+    if (traceEnabled())
+        traceEnd("semDown", trace_sem_name);
+}
+
+#ifdef SEMDEBUG
 #include "semDebug_sharedDataSync.h"
 
 struct semdebug_buff *semdebug_channel = NULL;
@@ -22,14 +161,15 @@ void semdebug_init(struct semdebug_buff *ch)
 
 static void semdebug_logEvent(struct semdebug_buff *ch,
                               enum SEMDEBUG_ACTION action,
-                              unsigned int index, const char *reason)
+                              unsigned int index, unsigned int line,
+                              const char *reason)
 {
+    semdebug_writeEvToBuffer(ch, action, index, line);
+
+#ifdef SEMDEBUG_WRITE_TO_STDERR
     if (!reason)
         reason = "";
 
-    semdebug_writeEvToBuffer(ch, action, index, reason);    
-
-#ifdef SEMDEBUG_WRITE_TO_STDERR
     char name[100];
     get_semaphore_name(&sh->fSt, index, name, 100);
     fprintf(stdout, "PID %d %s semaphore ID %d (\"%s\"): %s\n",
@@ -40,36 +180,76 @@ static void semdebug_logEvent(struct semdebug_buff *ch,
 
 int semDown (int my_semgid, unsigned int sindex)
 {
-    semdebug_logEvent(semdebug_channel, SEMDEBUG_DOWN, sindex, NULL);
+    semdebug_logEvent(semdebug_channel, SEMDEBUG_DOWN, sindex, 0, NULL);
     return semDown_raw(my_semgid, sindex);
 }
 
 int semUp (int my_semgid, unsigned int sindex)
 {
-    semdebug_logEvent(semdebug_channel, SEMDEBUG_UP, sindex, NULL);
+    semdebug_logEvent(semdebug_channel, SEMDEBUG_UP, sindex, 0, NULL);
     return semUp_raw(my_semgid, sindex);
 }
 
-int semDownOrExit(unsigned int index, const char *reason)
+// The call site line identifies the reason in semdebug_reasons[]
+// (generated from the entities sources by semDebugReasons.awk).
+#define semDownOrExit(index, reason) \
+    semdebug_downOrExit((index), __LINE__, (reason))
+#define semUpOrExit(index, reason) \
+    semdebug_upOrExit((index), __LINE__, (reason))
+#define semTimedDownOrExit(index, timeout, reason) \
+    semdebug_timedDownOrExit((index), (timeout), __LINE__, (reason))
+
+int semdebug_downOrExit(unsigned int index, unsigned int line, const char *reason)
 {
     int ret;
 
-    semdebug_logEvent(semdebug_channel, SEMDEBUG_DOWN, index, reason);
+    semdebug_logEvent(semdebug_channel, SEMDEBUG_DOWN, index, line, reason);
 
+    if (seq_down(index))
+        return 0;
+    wfg_before_down(index);
+    trace_before_down(index);
     if ((ret = semDown_raw (semgid, index)) == -1) {
         perror ("semaphore down access failed (semDebug's semDownOrExit())");
         exit (EXIT_FAILURE);
     }
+    trace_after_down();
+    wfg_after_down(index);
+    seq_after_down(index);
 
     return ret;
 }
 
-int semUpOrExit(unsigned int index, const char *reason)
+// A timed down is not a wait for another entity (the caller gives up after the timeout), so it is left out
+// of the wait-for graph.
+bool semdebug_timedDownOrExit(unsigned int index, long timeout, unsigned int line, const char *reason)
+{
+    trace_before_down(index);
+    if (semDownTimed (semgid, index, timeout) == -1) {
+        if (errno != EAGAIN) {
+            perror ("semaphore timed down access failed (semDebug's semTimedDownOrExit())");
+            exit (EXIT_FAILURE);
+        }
+        trace_after_down();
+        return false;
+    }
+    trace_after_down();
+    semdebug_logEvent(semdebug_channel, SEMDEBUG_DOWN, index, line, reason);
+    seq_after_down(index);
+
+    return true;
+}
+
+int semdebug_upOrExit(unsigned int index, unsigned int line, const char *reason)
 {
     int ret;
 
-    semdebug_logEvent(semdebug_channel, SEMDEBUG_UP, index, reason);
+    semdebug_logEvent(semdebug_channel, SEMDEBUG_UP, index, line, reason);
 
+    if (seq_up(index))
+        return 0;
+    seq_before_up(index);
+    wfg_before_up(index);
     if ((ret = semUp_raw (semgid, index)) == -1) {
         perror ("semaphore up access failed (semDebug's semDownOrExit())");
         exit (EXIT_FAILURE);
@@ -84,18 +264,48 @@ int semDownOrExit(unsigned int index, const char *reason)
 {
     int ret;
 
+    if (seq_down(index))
+        return 0;
+    wfg_before_down(index);
+    trace_before_down(index);
     if ((ret = semDown (semgid, index)) == -1) {
         perror ("semaphor down access failed (CT)");
         exit (EXIT_FAILURE);
     }
+    trace_after_down();
+    wfg_after_down(index);
+    seq_after_down(index);
 
     return ret;
 }
 
+// A timed down is not a wait for another entity (the caller gives up after the timeout), so it is left out
+// of the wait-for graph.
+bool semTimedDownOrExit(unsigned int index, long timeout, const char *reason)
+{
+    trace_before_down(index);
+    if (semDownTimed (semgid, index, timeout) == -1) {
+        if (errno != EAGAIN) {
+            perror ("semaphor timed down access failed (CT)");
+            exit (EXIT_FAILURE);
+        }
+        trace_after_down();
+        return false;
+    }
+    trace_after_down();
+    seq_after_down(index);
+
+    return true;
+}
+
 int semUpOrExit(unsigned int index, const char *reason)
 {
     int ret;
 
+    if (seq_up(index))
+        return 0;
+    seq_before_up(index);
+    wfg_before_up(index);
     if ((ret = semUp (semgid, index)) == -1) {
         perror ("semaphor down access failed (CT)");
         exit (EXIT_FAILURE);
@@ -0,0 +1,44 @@
+# Generates semDebugReasons.h: the table of the reasons given to semDownOrExit(),
+# semTimedDownOrExit() and semUpOrExit() in the entities sources, indexed by source and line.
+#
+# Usage: awk -f semDebugReasons.awk semSharedMem*.c > semDebugReasons.h
+#
+# Developed by the students.
+
+BEGIN {
+    print "// Generated by semDebugReasons.awk from the entities sources. Do not edit."
+    print ""
+    print "static const struct semdebug_reason semdebug_reasons[] = {"
+}
+
+FNR == 1 {
+    if (FILENAME ~ /Chef/)              src = "SEMDEBUG_SRC_CHEF"
+    else if (FILENAME ~ /Waiter/)       src = "SEMDEBUG_SRC_WAITER"
+    else if (FILENAME ~ /Receptionist/) src = "SEMDEBUG_SRC_RECEPTIONIST"
+    else if (FILENAME ~ /Group/)        src = "SEMDEBUG_SRC_GROUP"
+    else                                src = "SEMDEBUG_SRC_UNKNOWN"
+    pending = 0
+}
+
+# The reason of a call split over several lines is on one of the following lines.
+pending && match($0, /"([^"\\]|\\.)*"/) {
+    print "    { " src ", " line ", " substr($0, RSTART, RLENGTH) " },"
+    pending = 0
+    next
+}
+
+pending && /;/ { pending = 0 }
+
+/sem(Timed)?(Down|Up)OrExit *\(/ && !/^ *(int|bool|static|extern)/ {
+    line = FNR
+    call = substr($0, match($0, /sem(Timed)?(Down|Up)OrExit *\(/))
+    if (match(call, /"([^"\\]|\\.)*"/))
+        print "    { " src ", " line ", " substr(call, RSTART, RLENGTH) " },"
+    else if (call !~ /;/)
+        pending = 1
+}
+
+END {
+    print "    { SEMDEBUG_SRC_UNKNOWN, 0, \"\" }"
+    print "};"
+}
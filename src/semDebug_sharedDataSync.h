@@ -2,90 +2,8 @@
 
 // Developed by the students.
 
-#ifdef SEMDEBUG
-#include <dirent.h>
-#include <sys/sem.h>
-
-#define SEMDEBUG_MAX_EVENTS 20
-#define SEMDEBUG_MAX_REASON 100
-
-struct semdebug_event
-{
-    enum SEMDEBUG_ACTION
-    {
-        SEMDEBUG_UNDEFINED = 0,
-        SEMDEBUG_DOWN,
-        SEMDEBUG_UP
-    } action;
-    unsigned int index;
-    char reason[SEMDEBUG_MAX_REASON];
-};
-
-struct semdebug_buff
-{
-    pid_t pid;
-    size_t next_slot;
-    struct semdebug_event events[SEMDEBUG_MAX_EVENTS];
-};
-
-struct semdebug
-{
-    struct semdebug_buff chef, waiter, receptionist, groups[MAXGROUPS];
-};
-
-void semdebug_writeEvToBuffer(struct semdebug_buff *buffer, enum SEMDEBUG_ACTION action, unsigned int index, const char *reason)
-{
-    if (!buffer)
-        return;
-
-    struct semdebug_event *out = &buffer->events[buffer->next_slot];
-    out->action = action;
-    out->index = index;
-    strlcpy(out->reason, reason, SEMDEBUG_MAX_REASON);
-
-    buffer->next_slot = (buffer->next_slot + 1) % SEMDEBUG_MAX_EVENTS;
-}
-
-size_t semdebug_getAllEvSorted(const struct semdebug_buff *in, struct semdebug_event *out)
-{
-    if (!(in && out))
-        return false;
-
-    struct semdebug_event *outslot = out;
-    size_t nWritten = 0;
-
-    for (size_t i = 0; i < SEMDEBUG_MAX_EVENTS; i++)
-    {
-        size_t current_slot = (in->next_slot + i) % SEMDEBUG_MAX_EVENTS;
-        const struct semdebug_event *ev = &in->events[current_slot];
-
-        if (ev->action == SEMDEBUG_UNDEFINED)
-            continue;
-
-        *(outslot++) = *ev;
-        nWritten++;
-    }
-
-    return nWritten;
-}
-
-// -*-*- DIAGNOSTICS -*-*-
-
-struct semdebug_diag_proc
-{
-    pid_t pid;
-    int stage;
-    int waiting_on;
-    bool exited;
-    size_t n_events;
-    struct semdebug_event events[SEMDEBUG_MAX_EVENTS];
-    struct semdebug_event *last_event;
-};
-
-struct semdebug_diag_procset
-{
-    struct semdebug_diag_proc ch, wt, rc, gr[MAXGROUPS];
-};
+#include <stdio.h>
+#include "probDataStruct.h"
 
 int get_semaphore_name(const FULL_STAT *fd, unsigned int index,
                        char *out, size_t n)
@@ -131,12 +49,12 @@ int get_semaphore_name(const FULL_STAT *fd, unsigned int index,
     }
 
     if (s)
-        nWritten = strlcpy(out, s, n);
+        nWritten = snprintf(out, n, "%s", s);
 
     return nWritten;
 }
 
-static const char *get_group_stage_label(int stage)
+const char *get_group_stage_label(int stage)
 {
     switch (stage)
     {
@@ -151,7 +69,7 @@ static const char *get_group_stage_label(int stage)
     }
 }
 
-static const char *get_chef_stage_label(int stage)
+const char *get_chef_stage_label(int stage)
 {
         switch (stage)
         {
@@ -162,7 +80,7 @@ static const char *get_chef_stage_label(int stage)
         }
 }
 
-static const char *get_waiter_stage_label(int stage)
+const char *get_waiter_stage_label(int stage)
 {
     switch (stage)
     {
@@ -173,17 +91,18 @@ static const char *get_waiter_stage_label(int stage)
     }
 }
 
-static const char *get_receptionist_stage_label(int stage)
+const char *get_receptionist_stage_label(int stage)
 {
     switch (stage)
     {
+        case 0: return "WAIT_FOR_REQST";
         case 1: return "ASSIGNTABLE";
         case 2: return "RECVPAY";
         default: return "";
     }
 }
 
-static const char *get_request_label(int request)
+const char *get_request_label(int request)
 {
     switch (request)
     {
@@ -191,40 +110,183 @@ static const char *get_request_label(int request)
         case 2: return "BILLREQ";
         case 3: return "FOODREQ";
         case 4: return "FOODREADY";
+        case 5: return "DRAINREQ";
         default: return "";
     }
 }
 
+#ifdef SEMDEBUG
+#include <signal.h>
+#include <stdint.h>
+#include <sys/sem.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+#define SEMDEBUG_MAX_EVENTS 20
+
+enum SEMDEBUG_ACTION
+{
+    SEMDEBUG_UNDEFINED = 0,
+    SEMDEBUG_DOWN,
+    SEMDEBUG_UP
+};
+
+// Entity source files, which identify the call sites along with the line.
+enum SEMDEBUG_SOURCE
+{
+    SEMDEBUG_SRC_UNKNOWN = 0,
+    SEMDEBUG_SRC_CHEF,
+    SEMDEBUG_SRC_WAITER,
+    SEMDEBUG_SRC_RECEPTIONIST,
+    SEMDEBUG_SRC_GROUP
+};
+
+// Events are kept small and fixed-size: the reason is not copied, only the
+// line of the call site, which is looked up in semdebug_reasons[] when the
+// events are printed.
+struct semdebug_event
+{
+    uint64_t tsc;           // time stamp counter when the event was logged
+    uint16_t index;         // semaphore index
+    uint16_t line;          // line of the call site (0 if unknown)
+    uint8_t action;         // enum SEMDEBUG_ACTION
+};
+
+struct semdebug_reason
+{
+    enum SEMDEBUG_SOURCE src;
+    unsigned int line;
+    const char *text;
+};
+
+#include "semDebugReasons.h"
+
+const char *semdebug_getReason(enum SEMDEBUG_SOURCE src, unsigned int line)
+{
+    for (const struct semdebug_reason *r = semdebug_reasons; r->line; r++)
+        if (r->src == src && r->line == line)
+            return r->text;
+
+    return "";
+}
+
+static inline uint64_t semdebug_timestamp(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+#endif
+}
+
+struct semdebug_buff
+{
+    pid_t pid;
+    size_t next_slot;
+    struct semdebug_event events[SEMDEBUG_MAX_EVENTS];
+};
+
+struct semdebug
+{
+    struct semdebug_buff chef, waiter, receptionist, groups[MAXGROUPS];
+};
+
+void semdebug_writeEvToBuffer(struct semdebug_buff *buffer, enum SEMDEBUG_ACTION action, unsigned int index, unsigned int line)
+{
+    if (!buffer)
+        return;
+
+    buffer->events[buffer->next_slot] = (struct semdebug_event){
+        .tsc = semdebug_timestamp(),
+        .index = index,
+        .line = line,
+        .action = action
+    };
+
+    buffer->next_slot = (buffer->next_slot + 1) % SEMDEBUG_MAX_EVENTS;
+}
+
+size_t semdebug_getAllEvSorted(const struct semdebug_buff *in, struct semdebug_event *out)
+{
+    if (!(in && out))
+        return false;
+
+    struct semdebug_event *outslot = out;
+    size_t nWritten = 0;
+
+    for (size_t i = 0; i < SEMDEBUG_MAX_EVENTS; i++)
+    {
+        size_t current_slot = (in->next_slot + i) % SEMDEBUG_MAX_EVENTS;
+        const struct semdebug_event *ev = &in->events[current_slot];
+
+        if (ev->action == SEMDEBUG_UNDEFINED)
+            continue;
+
+        *(outslot++) = *ev;
+        nWritten++;
+    }
+
+    return nWritten;
+}
+
+// -*-*- DIAGNOSTICS -*-*-
+
+struct semdebug_diag_proc
+{
+    pid_t pid;
+    enum SEMDEBUG_SOURCE src;
+    int stage;
+    int waiting_on;
+    bool exited;
+    size_t n_events;
+    struct semdebug_event events[SEMDEBUG_MAX_EVENTS];
+    struct semdebug_event *last_event;
+};
+
+struct semdebug_diag_procset
+{
+    struct semdebug_diag_proc ch, wt, rc, gr[MAXGROUPS];
+};
+
 #define MYMIN(a, b) ((a) < (b) ? (a) : (b))
 
+static bool semdebug_proc_exited(pid_t pid)
+{
+    // Entities are reaped by the main process as soon as they terminate.
+    return kill(pid, 0) == -1;
+}
+
 bool semdebug_getProcDiagnostics(const struct semdebug *sd, const FULL_STAT *fd,
                         int semgid, struct semdebug_diag_procset *out)
 {
-    char buf[50];
-    
     if (!(sd && fd && out))
         return false;
     
     out->ch.pid = sd->chef.pid;
+    out->ch.src = SEMDEBUG_SRC_CHEF;
     out->ch.stage = fd->st.chefStat;
-    snprintf(buf, sizeof(buf)/sizeof(buf[0]), "/proc/%d", out->ch.pid);
-    out->ch.exited = (bool)(!opendir(buf));
+    out->ch.exited = semdebug_proc_exited(out->ch.pid);
     out->ch.n_events = semdebug_getAllEvSorted(&sd->chef, out->ch.events);
     out->ch.last_event = out->ch.n_events ?
         &out->ch.events[out->ch.n_events - 1] : NULL;
     
     out->wt.pid = sd->waiter.pid;
+    out->wt.src = SEMDEBUG_SRC_WAITER;
     out->wt.stage = fd->st.waiterStat;
-    snprintf(buf, sizeof(buf)/sizeof(buf[0]), "/proc/%d", out->wt.pid);
-    out->wt.exited = (bool)(!opendir(buf));
+    out->wt.exited = semdebug_proc_exited(out->wt.pid);
     out->wt.n_events = semdebug_getAllEvSorted(&sd->waiter, out->wt.events);
     out->wt.last_event = out->wt.n_events ?
         &out->wt.events[out->wt.n_events - 1] : NULL;
     
     out->rc.pid = sd->receptionist.pid;
+    out->rc.src = SEMDEBUG_SRC_RECEPTIONIST;
     out->rc.stage = fd->st.receptionistStat;
-    snprintf(buf, sizeof(buf)/sizeof(buf[0]), "/proc/%d", out->rc.pid);
-    out->rc.exited = (bool)(!opendir(buf));
+    out->rc.exited = semdebug_proc_exited(out->rc.pid);
     out->rc.n_events = semdebug_getAllEvSorted(&sd->receptionist, out->rc.events);
     out->rc.last_event = out->rc.n_events ?
         &out->rc.events[out->rc.n_events - 1] : NULL;
@@ -235,9 +297,9 @@ bool semdebug_getProcDiagnostics(const struct semdebug *sd, const FULL_STAT *fd,
         const struct semdebug_buff *grin = &sd->groups[i];
         
         gr->pid = grin->pid;
-        gr->stage = fd->st.groupStat[i];
-        snprintf(buf, sizeof(buf)/sizeof(buf[0]), "/proc/%d", gr->pid);
-        gr->exited = (bool)(!opendir(buf));
+        gr->src = SEMDEBUG_SRC_GROUP;
+        gr->stage = GROUPSTAT(fd->st, i);
+        gr->exited = semdebug_proc_exited(gr->pid);
         gr->n_events = semdebug_getAllEvSorted(grin, gr->events);
         gr->last_event = gr->n_events ? &gr->events[gr->n_events - 1] : NULL;
     }
@@ -249,11 +311,12 @@ bool semdebug_getProcDiagnostics(const struct semdebug *sd, const FULL_STAT *fd,
 
 void semdebug_print_deadlock_logs(const struct semdebug_event *ev,
                                   const struct semdebug_event *last,
+                                  enum SEMDEBUG_SOURCE src,
                                   const FULL_STAT *fd)
 {
     const char format_details_divider[] = "\
 ┃ ║ ──────────────────── last %2d semaphore operations ────────────────────── ║ ┃\n\
-┃ ║                          (most recent last)                              ║ ┃\n\
+┃ ║          (most recent last, with cycles elapsed since the previous)      ║ ┃\n\
 ┃ ║                                                                          ║ ┃\n";
     const char format_event_log[] = "\
 ┃ ║ %2u: %s %-66s ║ ┃\n";
@@ -285,10 +348,12 @@ void semdebug_print_deadlock_logs(const struct semdebug_event *ev,
             
             const int buffer_size = 200;
             char buffer[buffer_size];
-            get_semaphore_name(fd, ev->index, buffer, buffer_size);
+            int n = snprintf(buffer, buffer_size, "%+9lld ",
+                             count > 1 ? (long long)(ev->tsc - ev[-1].tsc) : 0LL);
+            get_semaphore_name(fd, ev->index, buffer + n, buffer_size - n);
             
             strlcat(buffer, ": ", buffer_size);
-            if (strlcat(buffer, ev->reason, buffer_size) > 65)
+            if (strlcat(buffer, semdebug_getReason(src, ev->line), buffer_size) > 65)
             {
                 buffer[65] = '\0';
                 strlcat(buffer, "…", buffer_size);
@@ -349,7 +414,7 @@ void semdebug_print_deadlock(struct semdebug *sd, const FULL_STAT *fd, int semgi
                     "down" : "up")
                 : "?",
             has_events ? (procset.ch.last_event->index) : 0,
-            has_events ? procset.ch.last_event->reason : "?"
+            has_events ? semdebug_getReason(procset.ch.src, procset.ch.last_event->line) : "?"
     );
     
     // Now print WT stuff.
@@ -364,7 +429,7 @@ void semdebug_print_deadlock(struct semdebug *sd, const FULL_STAT *fd, int semgi
                     "down" : "up")
                 : "?",
             has_events ? (procset.wt.last_event->index) : 0,
-            has_events ? procset.wt.last_event->reason : "?"
+            has_events ? semdebug_getReason(procset.wt.src, procset.wt.last_event->line) : "?"
     );
     
     // Now print RC stuff.
@@ -380,7 +445,7 @@ void semdebug_print_deadlock(struct semdebug *sd, const FULL_STAT *fd, int semgi
                     "down" : "up")
                 : "?",
             has_events ? (procset.rc.last_event->index) : 0,
-            has_events ? procset.rc.last_event->reason : "?"
+            has_events ? semdebug_getReason(procset.rc.src, procset.rc.last_event->line) : "?"
     );
 
     fprintf(stderr, footer_3summary);
@@ -404,7 +469,7 @@ void semdebug_print_deadlock(struct semdebug *sd, const FULL_STAT *fd, int semgi
         
         has_events = g->n_events;
         if (has_events)
-            if (strlcpy(trimmed_reason, le->reason, 40) > 28)
+            if (strlcpy(trimmed_reason, semdebug_getReason(g->src, le->line), 40) > 28)
             {
                 trimmed_reason[28] = '\0';
                 strlcat(trimmed_reason, "…", 40);
@@ -420,7 +485,7 @@ void semdebug_print_deadlock(struct semdebug *sd, const FULL_STAT *fd, int semgi
                 : "?",
                 has_events ? le->index : 0,
                 has_events ? trimmed_reason : "?",
-                fd->assignedTable[i]
+                GROUPTABLE(*fd, i)
         );
     }
     
@@ -471,7 +536,7 @@ void semdebug_print_deadlock(struct semdebug *sd, const FULL_STAT *fd, int semgi
             procset.ch.pid, procset.ch.exited ? "quit" : "present"
     );
     
-    semdebug_print_deadlock_logs(procset.ch.events, procset.ch.last_event, fd);
+    semdebug_print_deadlock_logs(procset.ch.events, procset.ch.last_event, procset.ch.src, fd);
     fprintf(stderr, footer_3summary);
     
     const char format_header_details_waiter[] = "\
@@ -487,7 +552,7 @@ void semdebug_print_deadlock(struct semdebug *sd, const FULL_STAT *fd, int semgi
             get_request_label(fd->waiterRequest.reqType),
             fd->waiterRequest.reqGroup);
     
-    semdebug_print_deadlock_logs(procset.wt.events, procset.wt.last_event, fd);
+    semdebug_print_deadlock_logs(procset.wt.events, procset.wt.last_event, procset.wt.src, fd);
     fprintf(stderr, footer_3summary);
 
     const char format_header_details_receptionist[] = "\
@@ -500,7 +565,7 @@ void semdebug_print_deadlock(struct semdebug *sd, const FULL_STAT *fd, int semgi
             procset.rc.pid, procset.rc.exited ? "quit" : "present"
     );
     
-    semdebug_print_deadlock_logs(procset.rc.events, procset.rc.last_event, fd);
+    semdebug_print_deadlock_logs(procset.rc.events, procset.rc.last_event, procset.rc.src, fd);
     fprintf(stderr, footer_3summary);
 
     const char format_header_details_group[] = "\
@@ -514,10 +579,10 @@ void semdebug_print_deadlock(struct semdebug *sd, const FULL_STAT *fd, int semgi
         
         fprintf(stderr, format_header_details_group,
                 i, g->stage, get_group_stage_label(g->stage),
-                g->pid, g->exited ? "quit" : "present", fd->assignedTable[i]
+                g->pid, g->exited ? "quit" : "present", GROUPTABLE(*fd, i)
         );
         
-        semdebug_print_deadlock_logs(g->events, g->last_event, fd);
+        semdebug_print_deadlock_logs(g->events, g->last_event, g->src, fd);
         fprintf(stderr, footer_3summary);
     }
     
@@ -9,6 +9,7 @@
  *  Definition of the operations carried out by the chef:
  *     \li waitOrder
  *     \li processOrder
+ *     \li cookAtStations
  *
  *  \author Nuno Lau - December 2023
  */
@@ -23,6 +24,7 @@
 #include <signal.h>
 #include <sys/time.h>
 #include <errno.h>
+#include <time.h>
 
 #include "probConst.h"
 #include "probDataStruct.h"
@@ -47,11 +49,25 @@ static int lastGroup;
 /** \brief pointer to shared memory region */
 static SHARED_DATA *sh;
 
+/** \brief longest wait of the chef for the waiter, with a dish ready, before looking for new orders (in us) */
+#define HANDOFFPOLL 1000
+
+/** \brief orders accepted and not yet delivered, in the order they were received (with stations) */
+static int pendingGroup[NUMTABLES];
+
+/** \brief time each pending order is ready (monotonic clock, in microseconds; -1 while waiting for a station) */
+static long pendingReadyAt[NUMTABLES];
+
+/** \brief number of pending orders */
+static int nPending = 0;
+
 // Extra semaphore functions written by the students.
 #include "semDebug.h"
+#include "entityState.h"
 
 static void waitForOrder ();
 static void processOrder ();
+static void cookAtStations ();
 
 /**
  *  \brief Main program.
@@ -95,7 +111,17 @@ int main (int argc, char *argv[])
         perror ("error on mapping the shared region on the process address space");
         return EXIT_FAILURE;
     }
-
+    if (sh->prefault)
+        shmemPrefault (sh, sizeof (SHARED_DATA), false);
+
+    wfg_init(WFG_CHEF);
+    traceOpen (sh->traceFile, "chef");
+    if (sh->logMapped)
+        logMapOpen (nFic, &sh->logCursor);
+    if (sh->logShards)
+        logShardOpen (nFic, "CH", &sh->logSeq);
+    startStateTime ();
+    semSetStats (sh->semStats, SEM_NU);
 #ifdef SEMDEBUG
     semdebug_init(&sh->debug.chef);
 #endif
@@ -105,12 +131,18 @@ int main (int argc, char *argv[])
 
     /* simulation of the life cycle of the chef */
 
-    int nOrders=0;
-    while(nOrders < sh->fSt.nGroups) {
-       waitForOrder();
-       processOrder();
-
-       nOrders++;
+    if (sh->chefStations > 1)
+       cookAtStations();
+    else {
+       int nOrders=0;
+       while(sh->daemon || nOrders < sh->fSt.nGroups) {
+          waitForOrder();
+          if (sh->daemon && lastGroup < 0)        // order for no group: drain request from the main process
+              break;
+          processOrder();
+
+          nOrders++;
+       }
     }
 
     /* unmapping the shared region off the process address space */
@@ -133,8 +165,7 @@ int main (int argc, char *argv[])
 static void waitForOrder ()
 {
     semDownOrExit(sh->mutex, "pre-WAIT_FOR_ORDER");
-        sh->fSt.st.chefStat = WAIT_FOR_ORDER;
-        saveState(nFic, &(sh->fSt));
+        setChefState(WAIT_FOR_ORDER);
     semUpOrExit(sh->mutex, "WAIT_FOR_ORDER & state saved.");
 
     lastGroup = -1;
@@ -159,15 +190,13 @@ static void processOrder ()
         return;
 
     semDownOrExit(sh->mutex, "pre-COOK");
-        sh->fSt.st.chefStat = COOK;
-        saveState(nFic, &sh->fSt);
+        setChefState(COOK);
     semUpOrExit(sh->mutex, "COOKing food & state saved.");
 
     usleep((unsigned int) floor ((MAXCOOK * random ()) / RAND_MAX + 100.0));
 
     semDownOrExit(sh->mutex, "pre-REST");
-        sh->fSt.st.chefStat = REST;
-        saveState(nFic, &sh->fSt);
+        setChefState(REST);
     semUpOrExit(sh->mutex, "REST after cooking & state saved.");
 
 
@@ -177,3 +206,107 @@ static void processOrder ()
     semUpOrExit(sh->waiterRequest, "signalling food delivered to waiter");
 }
 
+/** \brief current time (monotonic clock, in microseconds) */
+static long nowUs()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+/** \brief chef changes its state, only if it is a new one */
+static void changeChefState(unsigned int state)
+{
+    if (sh->fSt.st.chefStat == state)
+        return;
+    semDownOrExit(sh->mutex, "pre-state change (stations)");
+        setChefState(state);
+    semUpOrExit(sh->mutex, "state changed (stations) & state saved.");
+}
+
+/**
+ *  \brief starts cooking the pending orders that wait for a free station.
+ *
+ *  \return time the next dish being cooked is ready (-1 if none is being cooked)
+ */
+static long startCooking(long now)
+{
+    int i, cooking = 0;
+    long next = -1;
+
+    for (i = 0; i < nPending; i++)
+        if (pendingReadyAt[i] > now)
+            cooking++;
+    for (i = 0; i < nPending; i++) {
+        if (pendingReadyAt[i] == -1 && cooking < sh->chefStations) {
+            pendingReadyAt[i] = now + (long) floor ((MAXCOOK * random ()) / RAND_MAX + 100.0);
+            cooking++;
+        }
+        if (pendingReadyAt[i] > now && (next == -1 || pendingReadyAt[i] < next))
+            next = pendingReadyAt[i];
+    }
+    return next;
+}
+
+/** \brief pending order whose dish was ready first (-1 if no dish is ready) */
+static int firstReady(long now)
+{
+    int i, first = -1;
+
+    for (i = 0; i < nPending; i++)
+        if (pendingReadyAt[i] != -1 && pendingReadyAt[i] <= now &&
+            (first == -1 || pendingReadyAt[i] < pendingReadyAt[first]))
+            first = i;
+    return first;
+}
+
+/**
+ *  \brief chef cooks several orders at the same time, one per station.
+ *
+ *  The chef keeps accepting orders while cooking: each order waits for a free station,
+ *  is cooked for its own time and is handed to the waiter as soon as it is ready.
+ *  The waiter only reads new requests once its order is acknowledged, so the chef never
+ *  blocks on the waiter while an order may be pending: it waits for the waiter at most
+ *  HANDOFFPOLL, and for an order at most until the next dish is ready.
+ *  The chef is cooking while a station is busy and rests while a dish waits for the waiter.
+ */
+static void cookAtStations()
+{
+    int nDelivered = 0, r;
+    long now, next;
+
+    while(sh->daemon || nDelivered < sh->fSt.nGroups) {
+        now = nowUs();
+        next = startCooking(now);
+        r = firstReady(now);
+        changeChefState(r != -1 ? REST : next != -1 ? COOK : WAIT_FOR_ORDER);
+
+        if (r != -1) {
+            if (semTimedDownOrExit(sh->waiterRequestPossible, HANDOFFPOLL, "food ready, waiter available")) {
+                sh->fSt.waiterRequest = (request) { FOODREADY, pendingGroup[r] };
+                nPending--;
+                memmove(&pendingGroup[r], &pendingGroup[r+1], (nPending - r) * sizeof(int));
+                memmove(&pendingReadyAt[r], &pendingReadyAt[r+1], (nPending - r) * sizeof(long));
+                semUpOrExit(sh->waiterRequest, "signalling food delivered to waiter");
+                nDelivered++;
+                continue;
+            }
+            if (!semTimedDownOrExit(sh->waitOrder, 0, "order received while food ready"))
+                continue;
+        }
+        else if (next != -1) {
+            if (!semTimedDownOrExit(sh->waitOrder, next - now, "order received while cooking"))
+                continue;
+        }
+        else semDownOrExit(sh->waitOrder, "waiting for orders");
+
+        lastGroup = sh->fSt.foodGroup;
+        semUpOrExit(sh->orderReceived, "order received successfully");
+        if (lastGroup < 0)        // order for no group: drain request from the main process
+            break;
+        pendingGroup[nPending] = lastGroup;
+        pendingReadyAt[nPending] = -1;
+        nPending++;
+    }
+}
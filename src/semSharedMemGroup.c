@@ -24,6 +24,7 @@
 #include <sys/types.h>
 #include <string.h>
 #include <math.h>
+#include <time.h>
 
 #include "probConst.h"
 #include "probDataStruct.h"
@@ -44,8 +45,15 @@ static int semgid;
 /** \brief pointer to shared memory region */
 static SHARED_DATA *sh;
 
+/** \brief number of the visit of the group (daemon mode) */
+static int visit = 0;
+
+/** \brief if the group got an arrival for its visit (daemon mode) */
+static bool arrived = true;
+
 // Extra semaphore functions written by the students.
 #include "semDebug.h"
+#include "entityState.h"
 
 static void goToRestaurant (int id);
 static void checkInAtReception (int id);
@@ -54,6 +62,18 @@ static void waitFood (int id);
 static void eat (int id);
 static void checkOutAtReception (int id);
 
+/** \brief maximum back-off of a group turned away, as a multiple of the initial one */
+#define MAXBACKOFF 16
+
+/** \brief longest sleep before checking if the restaurant is drained, while waiting for an arrival (in us) */
+#define DRAINPOLL 50000
+
+/** \brief sleep while the next arrival is not drawn yet (in us) */
+#define ARRIVALPOLL 1000
+
+/** \brief runs a phase of the life cycle of the group, recording it in the trace */
+#define PHASE(phase, id)  do { traceBegin ("phase", #phase); phase (id); traceEnd ("phase", #phase); } while (0)
+
 /**
  *  \brief Main program.
  *
@@ -64,6 +84,8 @@ int main (int argc, char *argv[])
     int key;                                         /*access key to shared memory and semaphore set */
     char *tinp;                                                    /* numerical parameters test flag */
     int n;
+    char procName[20];                                                  /* name of the process in the trace */
+    char shardName[16];                                                   /* name of the process in the log */
 
     /* validation of command line parameters */
     if (argc != 5) { 
@@ -102,21 +124,45 @@ int main (int argc, char *argv[])
         perror ("error on mapping the shared region on the process address space");
         return EXIT_FAILURE;
     }
+    if (sh->prefault)
+        shmemPrefault (sh, sizeof (SHARED_DATA), false);
 
     /* initialize random generator */
     srandom ((unsigned int) getpid ());                                                 
 
+    wfg_init(n);
+    snprintf (procName, sizeof (procName), "group %d", n);
+    traceOpen (sh->traceFile, procName);
+    if (sh->logMapped)
+        logMapOpen (nFic, &sh->logCursor);
+    if (sh->logShards) {
+        snprintf (shardName, sizeof (shardName), "GR%02d", n);
+        logShardOpen (nFic, shardName, &sh->logSeq);
+    }
+    startStateTime ();
+    semSetStats (sh->semStats, SEM_NU);
 #ifdef SEMDEBUG
     semdebug_init(&sh->debug.groups[n]);
 #endif
 
-    /* simulation of the life cycle of the group */
-    goToRestaurant(n);
-    checkInAtReception(n);
-    orderFood(n);
-    waitFood(n);
-    eat(n);
-    checkOutAtReception(n);
+    /* simulation of the life cycle of the group (repeated in daemon mode until the restaurant is drained) */
+    do {
+        if (visit > 0) {
+            semDownOrExit(sh->mutex, "pre-GOTOREST");
+                setGroupState(n, GOTOREST);
+            semUpOrExit(sh->mutex, "back to GOTOREST & state saved.");
+        }
+        PHASE(goToRestaurant, n);
+        if (!arrived || __atomic_load_n(&sh->draining, __ATOMIC_ACQUIRE))
+            break;
+        PHASE(checkInAtReception, n);
+        PHASE(orderFood, n);
+        PHASE(waitFood, n);
+        PHASE(eat, n);
+        PHASE(checkOutAtReception, n);
+        __atomic_fetch_add(&sh->visits, 1, __ATOMIC_RELAXED);
+        visit++;
+    } while (sh->daemon);
 
     /* unmapping the shared region off the process address space */
     if (shmemDettach (sh) == -1) {
@@ -147,16 +193,66 @@ static double normalRand(double stddev)
    return r*stddev;
 }
 
+/**
+ *  \brief group takes the next arrival of the workload (daemon mode)
+ *
+ *  The arrivals are drawn by the main process (see workload.h); the group waits for the time of the one it
+ *  takes, which is already past if every group was busy, and its eating time becomes the group's.
+ *  The group gives up as soon as the restaurant is drained or the workload has no more arrivals.
+ *
+ *  \param id group id
+ *
+ *  \return true if the group goes to the restaurant, false otherwise
+ */
+static bool takeArrival (int id)
+{
+    ARRIVAL_QUEUE *q = &sh->arrivals;
+    ARRIVAL *a;
+    unsigned long ticket;
+    long long arrival, wait;
+    struct timespec now;
+
+    if (__atomic_load_n(&sh->draining, __ATOMIC_ACQUIRE))
+        return false;
+    ticket = __atomic_fetch_add(&q->next, 1, __ATOMIC_RELAXED);
+    a = &q->slot[ticket % ARRIVALQUEUE];
+    while (__atomic_load_n(&a->seq, __ATOMIC_ACQUIRE) != ticket + 1) {
+        if (__atomic_load_n(&q->end, __ATOMIC_ACQUIRE) && (ticket >= __atomic_load_n(&q->drawn, __ATOMIC_ACQUIRE)))
+            return false;
+        if (__atomic_load_n(&sh->draining, __ATOMIC_ACQUIRE))
+            return false;
+        usleep(ARRIVALPOLL);
+    }
+    arrival = a->time;
+    GROUPEAT(sh->fSt, id) = a->eatTime;
+    __atomic_store_n(&a->seq, ticket + ARRIVALQUEUE, __ATOMIC_RELEASE);
+
+    while (!__atomic_load_n(&sh->draining, __ATOMIC_ACQUIRE)) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        wait = arrival - ((now.tv_sec - q->start.tv_sec) * 1000000LL + (now.tv_nsec - q->start.tv_nsec) / 1000);
+        if (wait <= 0)
+            return true;
+        usleep((unsigned int) ((wait < DRAINPOLL) ? wait : DRAINPOLL));
+    }
+    return false;
+}
+
 /**
  *  \brief group goes to restaurant 
  *
- *  The group takes its time to get to restaurant.
+ *  The group takes its time to get to restaurant; in daemon mode it comes back for the next arrival of the
+ *  workload.
  *
  *  \param id group id
  */
 static void goToRestaurant (int id)
 {
-    double startTime = sh->fSt.startTime[id] + normalRand(STARTDEV);
+    if (visit > 0) {
+        arrived = takeArrival(id);
+        return;
+    }
+
+    double startTime = GROUPSTART(sh->fSt, id) + normalRand(STARTDEV);
     
     if (startTime > 0.0) {
         usleep((unsigned int) startTime );
@@ -172,7 +268,7 @@ static void goToRestaurant (int id)
  */
 static void eat (int id)
 {
-    double eatTime = sh->fSt.eatTime[id] + normalRand(EATDEV);
+    double eatTime = GROUPEAT(sh->fSt, id) + normalRand(EATDEV);
     
     if (eatTime > 0.0) {
         usleep((unsigned int) eatTime );
@@ -193,19 +289,35 @@ static void eat (int id)
  */
 static void checkInAtReception(int id)
 {
-    semDownOrExit(sh->mutex, "pre-ATRECEPTION.");
-        sh->fSt.st.groupStat[id] = ATRECEPTION;
-        saveState(nFic, &sh->fSt);
-    semUpOrExit(sh->mutex, "ATRECEPTION & state saved.");
+    long backoff = sh->admitBackoff;
+
+    while (true) {
+        semDownOrExit(sh->mutex, "pre-ATRECEPTION.");
+            setGroupState(id, ATRECEPTION);
+        semUpOrExit(sh->mutex, "ATRECEPTION & state saved.");
+
+        // Wait for receptionist to be ready by waiting on his semaphore.
+        semDownOrExit(sh->receptionistRequestPossible, "before writing request for table.");
 
-    // Wait for receptionist to be ready by waiting on his semaphore.
-    semDownOrExit(sh->receptionistRequestPossible, "before writing request for table.");
+        // Now we can be sure we're the only one talking to the receptionist.
+        sh->fSt.receptionistRequest = (request){ TABLEREQ, id };
 
-    // Now we can be sure we're the only one talking to the receptionist.
-    sh->fSt.receptionistRequest = (request){ TABLEREQ, id };
+        semUpOrExit(sh->receptionistReq, "requested a table to sit down.");
+        semDownOrExit(sh->waitForTable[id], "waiting to sit down at table.");
 
-    semUpOrExit(sh->receptionistReq, "requested a table to sit down.");
-    semDownOrExit(sh->waitForTable[id], "waiting to sit down at table.");
+        if (!sh->turnedAway[id])
+            break;
+
+        // Turned away by admission control: come back later, backing off
+        // further (with jitter) after each refusal.
+        semDownOrExit(sh->mutex, "pre-GOTOREST (turned away).");
+            setGroupState(id, GOTOREST);
+        semUpOrExit(sh->mutex, "turned away, GOTOREST & state saved.");
+
+        usleep((unsigned int) (backoff * (0.5 + random() / (RAND_MAX + 1.0))));
+        if (backoff < MAXBACKOFF * sh->admitBackoff)
+            backoff *= 2;
+    }
 }
 
 /**
@@ -221,8 +333,7 @@ static void checkInAtReception(int id)
 static void orderFood (int id)
 {
     semDownOrExit (sh->mutex, "pre-FOOD_REQUEST.");
-        sh->fSt.st.groupStat[id] = FOOD_REQUEST;
-        saveState(nFic, &sh->fSt);
+        setGroupState(id, FOOD_REQUEST);
     semUpOrExit (sh->mutex, "FOOD_REQUEST & state saved.");
     
     // ----------------------------- //
@@ -232,7 +343,7 @@ static void orderFood (int id)
     sh->fSt.waiterRequest = (request){ FOODREQ, id };
     semUpOrExit (sh->waiterRequest, "finished writing food order.");
 
-    int table = sh->fSt.assignedTable[id];
+    int table = GROUPTABLE(sh->fSt, id);
     semDownOrExit (sh->requestReceived[table], "waiting for waiter to receive our order.");
 }
 
@@ -248,18 +359,16 @@ static void orderFood (int id)
 static void waitFood (int id)
 {
     semDownOrExit (sh->mutex, "pre-WAIT_FOR_FOOD");
-        sh->fSt.st.groupStat[id] = WAIT_FOR_FOOD;
-        saveState(nFic, &sh->fSt);
+        setGroupState(id, WAIT_FOR_FOOD);
     semUpOrExit (sh->mutex, "WAIT_FOR_FOOD & state saved.");
 
     // TODO insert your code here
-    int table = sh->fSt.assignedTable[id];
+    int table = GROUPTABLE(sh->fSt, id);
 
     semDownOrExit (sh->foodArrived[table], "waiting for our food to arrive.");
 
     semDownOrExit(sh->mutex, "pre-EAT");
-        sh->fSt.st.groupStat[id] = EAT;
-        saveState(nFic, &sh->fSt);
+        setGroupState(id, EAT);
     semUpOrExit(sh->mutex, "EAT & state saved.");
 }
 
@@ -278,11 +387,10 @@ static void checkOutAtReception (int id)
 {
     // Get table first; I have the suspicion the table info was getting swiped
     // from under our feet.
-    int table = sh->fSt.assignedTable[id];
+    int table = GROUPTABLE(sh->fSt, id);
 
     semDownOrExit(sh->mutex, "pre-CHECKOUT");
-        sh->fSt.st.groupStat[id] = CHECKOUT;
-        saveState(nFic, &sh->fSt);
+        setGroupState(id, CHECKOUT);
     semUpOrExit(sh->mutex, "CHECKOUT & state saved.");
 
     semDownOrExit(sh->receptionistRequestPossible, "before requesting bill.");
@@ -293,7 +401,6 @@ static void checkOutAtReception (int id)
     semDownOrExit(sh->tableDone[table], "waiting for receptionist to acknowledge payment.");
 
     semDownOrExit(sh->mutex, "pre-LEAVING");
-        sh->fSt.st.groupStat[id] = LEAVING;
-        saveState(nFic, &sh->fSt);
+        setGroupState(id, LEAVING);
     semUpOrExit(sh->mutex, "group left restaurant & state saved.");
 }
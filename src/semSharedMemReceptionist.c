@@ -22,6 +22,7 @@
 #include <string.h>
 #include <math.h>
 #include <assert.h>
+#include <time.h>
 
 #include "probConst.h"
 #include "probDataStruct.h"
@@ -29,6 +30,7 @@
 #include "sharedDataSync.h"
 #include "semaphore.h"
 #include "sharedMemory.h"
+#include "receptionistPolicy.h"
 
 /** \brief logging file name */
 static char nFic[51];
@@ -43,6 +45,7 @@ static int semgid;
 static SHARED_DATA *sh;
 
 #include "semDebug.h"
+#include "entityState.h"
 
 /* constants for groupRecord */
 #define TOARRIVE 0
@@ -53,34 +56,24 @@ static SHARED_DATA *sh;
 /** \brief receptioninst view on each group evolution (useful to decide table binding) */
 static int groupRecord[MAXGROUPS];
 
-/** \brief more useful view of groupRecord. Student-made. **/
-struct record {
-    unsigned int status;
-    char n_occupied, next_table;
-    int list_begin, list_end;
-    char waitlist[(MAXGROUPS-2) * sizeof(int) / sizeof(char)];
-} *rec = (struct record *)groupRecord;
-
-static int WAITLIST_LENGTH = sizeof(rec->waitlist) / sizeof(rec->waitlist[0]);
-static bool is_table_occupied(int t) { return rec->status & (1 << t); }
-static void set_table_occupied(int t, bool occupied)
-{
-    if (occupied) {
-        rec->status |= (1 << t);
-        rec->n_occupied++;
-        rec->next_table = (t+1) % NUMTABLES;
-    } else {
-        rec->status &= ~(1 << t);
-        rec->n_occupied--;
-    }
-}
+/** \brief receptionist view of the tables and of the waiting room (see receptionistPolicy.h) */
+static POLICY policy;
+
+/** \brief predicted time each table is free (monotonic clock, in microseconds, see receptionistPolicy.h) */
+static WAIT_PREDICTOR predictor;
+
+/** \brief time the present request is served (monotonic clock, in microseconds) */
+static long reqTime;
+
 
+/** \brief current time (monotonic clock, in microseconds) */
+static long nowUs ();
 
 /** \brief receptionist waits for next request */
 static request waitForGroup ();
 
-/** \brief receptionist waits for next request */
-static void provideTableOrWaitingRoom (int n);
+/** \brief receptionist decides if group occupies a table, waits or is turned away */
+static bool provideTableOrWaitingRoom (int n);
 
 /** \brief receptionist receives payment */
 static void receivePayment (int n);
@@ -129,7 +122,19 @@ int main (int argc, char *argv[])
         perror ("error on mapping the shared region on the process address space");
         return EXIT_FAILURE;
     }
-
+    if (sh->prefault)
+        shmemPrefault (sh, sizeof (SHARED_DATA), false);
+
+    wfg_init(WFG_RECEPTIONIST);
+    traceOpen (sh->traceFile, "receptionist");
+    if (sh->logMapped)
+        logMapOpen (nFic, &sh->logCursor);
+    if (sh->logShards)
+        logShardOpen (nFic, "RC", &sh->logSeq);
+    if (strlen (sh->recFile) != 0)
+        logRecordOpen (sh->recFile);
+    startStateTime ();
+    semSetStats (sh->semStats, SEM_NU);
 #ifdef SEMDEBUG
     semdebug_init(&sh->debug.receptionist);
 #endif
@@ -142,15 +147,21 @@ int main (int argc, char *argv[])
     for (g=0; g < sh->fSt.nGroups; g++) {
        groupRecord[g] = TOARRIVE;
     }
+    policyInit (&policy);
+    predictorInit (&predictor);
 
     /* simulation of the life cycle of the receptionist */
     int nReq=0;
     request req;
-    while( nReq < sh->fSt.nGroups*2 ) {
+    while( sh->daemon || nReq < sh->fSt.nGroups*2 ) {
         req = waitForGroup();
+        if (req.reqType == DRAINREQ)
+            break;
+        reqTime = nowUs();
         switch(req.reqType) {
             case TABLEREQ:
-                   provideTableOrWaitingRoom(req.reqGroup); //TODO param should be groupid
+                   if (!provideTableOrWaitingRoom(req.reqGroup))
+                       continue;   // turned away: the group asks again later
                    break;
             case BILLREQ:
                    receivePayment(req.reqGroup);
@@ -168,51 +179,50 @@ int main (int argc, char *argv[])
     return EXIT_SUCCESS;
 }
 
+/** \brief current time (monotonic clock, in microseconds) */
+static long nowUs()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
 /**
- *  \brief decides table to occupy for group n or if it must wait.
+ *  \brief decides if group n, that has no vacant table, may join the waiting room.
  *
- *  Checks current state of tables and groups in order to decide table or wait.
+ *  The group is turned away if the waiting room is full or if its predicted wait is too long.
  *
- *  \return table id or -1 (in case of wait decision)
+ *  \return true if the group is admitted
  */
-static int decideTableOrWait(int n)
+static bool admitGroup(int n, long wait)
 {
-    if (rec->n_occupied == NUMTABLES)
-        return -1;
-
-    for (int i = 0; i < NUMTABLES; i++)
-    {
-        int index = (i + rec->next_table) % NUMTABLES;
-        bool occupied = is_table_occupied(index);
-
-        if (occupied)
-            continue;
-        else
-            return index;
-    }
+    if (sh->admitQueue > 0 && policy.nWaiting >= sh->admitQueue)
+        return false;
 
-    return -1;
+    if (sh->admitWait > 0 && wait > sh->admitWait)
+        return false;
+
+    return true;
 }
 
 /**
- *  \brief called when a table gets vacant and there are waiting groups 
- *         to decide which group (if any) should occupy it.
- *
- *  Checks current state of tables and groups in order to decide group.
- *
- *  \return group id or -1 (in case of wait decision)
+ *  \brief publishes the wait predicted for group n, in shared memory and in the record file.
  */
-static int decideNextGroup()
+static void publishWait(int n, long wait)
 {
-    int g = -1;
-    
-    if (sh->fSt.groupsWaiting) {
-        g = rec->waitlist[rec->list_begin];
-        rec->list_begin = (rec->list_begin + 1) % WAITLIST_LENGTH;
-        sh->fSt.groupsWaiting--;
-    }
-    
-    return g;
+    semDownOrExit(sh->mutex, NULL);
+        sh->expectedWait[n] = wait;
+    semUpOrExit(sh->mutex, "published expected wait.");
+    saveWaitEstimate(n, wait);
+}
+
+/**
+ *  \brief records a request served in the record file, for replay.
+ */
+static void recordServed(const char *kind, int n, int table)
+{
+    saveRequestServed(reqTime, kind, n, table);
 }
 
 /**
@@ -230,8 +240,7 @@ static request waitForGroup()
 
     semDownOrExit(sh->mutex, NULL);
         // No status code provided for "waiting".
-        sh->fSt.st.receptionistStat = 0;
-        saveState(nFic, &(sh->fSt));
+        setReceptionistState(0);
     semUpOrExit(sh->mutex, "state changed to 0 (waiting).");
 
     semDownOrExit(sh->receptionistReq, "waiting for requests.");
@@ -248,26 +257,55 @@ static request waitForGroup()
  *  or waits. Shared (and internal) memory may need to be updated.
  *  If group occupies table, it must be informed that it may proceed. 
  *  The internal state should be saved.
+ *  With admission control, a group that may not wait is informed that it
+ *  must come back later.
+ *  On a new request, the predicted wait of the group is published before
+ *  it is informed.
  *
+ *  \return false if the group was turned away
  */
-static void provideTableOrWaitingRoom (int n)
+static bool provideTableOrWaitingRoom (int n)
 {
     semDownOrExit(sh->mutex, NULL);
-        sh->fSt.st.receptionistStat = ASSIGNTABLE;
-        saveState(nFic, &(sh->fSt));
+        setReceptionistState(ASSIGNTABLE);
     semUpOrExit(sh->mutex, "new state: ASSIGNTABLE.");
     
-    int table = decideTableOrWait(n);
+    int table = decideTableOrWait(&policy, n);
+    bool newRequest = (groupRecord[n] != WAIT);
+    long now = reqTime, wait;
     
     if (table > -1) {
-        set_table_occupied(table, true);
-        sh->fSt.assignedTable[n] = table;
+        setTableOccupied(&policy, table, true);
+        predictSeated(&predictor, table, n, GROUPEAT(sh->fSt, n), now);
+        groupRecord[n] = ATTABLE;
+        recordServed(newRequest ? "TABLE" : "SEAT", n, table);
+        if (newRequest)
+            publishWait(n, 0);
+        semDownOrExit(sh->mutex, NULL);
+            GROUPTABLE(sh->fSt, n) = table;
+            publishTables();
+        semUpOrExit(sh->mutex, "table of group saved.");
+        sh->turnedAway[n] = false;
         semUpOrExit(sh->waitForTable[n], "assigned table to group.");
+    } else if (!admitGroup(n, wait = predictWait(&predictor, now))) {
+        recordServed("TABLE", n, REQ_AWAY);
+        publishWait(n, wait);
+        sh->turnedAway[n] = true;
+        sh->turnedAwayCount++;
+        semUpOrExit(sh->waitForTable[n], "turned group away, come back later.");
+        return false;
     } else {
-        rec->waitlist[rec->list_end] = n;
-        rec->list_end = (rec->list_end + 1) % WAITLIST_LENGTH;
-        sh->fSt.groupsWaiting++;
+        addToWaitingRoom(&policy, n);
+        recordServed("TABLE", n, REQ_WAIT);
+        publishWait(n, predictJoin(&predictor, n, GROUPEAT(sh->fSt, n), now));
+        groupRecord[n] = WAIT;
+        semDownOrExit(sh->mutex, NULL);
+            sh->fSt.groupsWaiting++;
+            publishTables();
+        semUpOrExit(sh->mutex, "group joined the waiting room.");
     }
+
+    return true;
 }
 
 /**
@@ -283,23 +321,32 @@ static void provideTableOrWaitingRoom (int n)
 static void receivePayment (int n)
 {
     semDownOrExit(sh->mutex, NULL);
-        sh->fSt.st.receptionistStat = RECVPAY;
-        saveState(nFic, &sh->fSt);
+        setReceptionistState(RECVPAY);
     semUpOrExit(sh->mutex, "new state: RECVPAY");
 
     int group = n;
-    int table = sh->fSt.assignedTable[group];
+    int table = GROUPTABLE(sh->fSt, group);
 
     if (table < 0) {
         semDownOrExit(sh->mutex, "!!! BUG: Table not found!");
         sleep(-1);
     }
 
-    sh->fSt.assignedTable[group] = -1;
-    set_table_occupied(table, false);
+    semDownOrExit(sh->mutex, NULL);
+        GROUPTABLE(sh->fSt, group) = -1;
+        publishTables();
+    semUpOrExit(sh->mutex, "table of group released.");
+    setTableOccupied(&policy, table, false);
+    predictVacated(&predictor, table, reqTime);
+    groupRecord[group] = DONE;
+    recordServed("BILL", group, table);
     semUpOrExit(sh->tableDone[table], "Signalling payment received");
 
-    if ((group = decideNextGroup()) > -1) {
+    if ((group = decideNextGroup(&policy)) > -1) {
+        semDownOrExit(sh->mutex, NULL);
+            sh->fSt.groupsWaiting--;
+            publishTables();
+        semUpOrExit(sh->mutex, "group left the waiting room.");
         provideTableOrWaitingRoom(group);
     }
 }
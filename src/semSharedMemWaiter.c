@@ -44,6 +44,7 @@ static SHARED_DATA *sh;
 
 // Made by the students.
 #include "semDebug.h"
+#include "entityState.h"
 
 /** \brief waiter waits for next request */
 static request waitForClientOrChef ();
@@ -99,7 +100,17 @@ int main (int argc, char *argv[])
         perror ("error on mapping the shared region on the process address space");
         return EXIT_FAILURE;
     }
-
+    if (sh->prefault)
+        shmemPrefault (sh, sizeof (SHARED_DATA), false);
+
+    wfg_init(WFG_WAITER);
+    traceOpen (sh->traceFile, "waiter");
+    if (sh->logMapped)
+        logMapOpen (nFic, &sh->logCursor);
+    if (sh->logShards)
+        logShardOpen (nFic, "WT", &sh->logSeq);
+    startStateTime ();
+    semSetStats (sh->semStats, SEM_NU);
 #ifdef SEMDEBUG
     semdebug_init(&sh->debug.waiter);
 #endif
@@ -110,8 +121,10 @@ int main (int argc, char *argv[])
     /* simulation of the life cycle of the waiter */
     int nReq=0;
     request req;
-    while( nReq < sh->fSt.nGroups*2 ) {
+    while( sh->daemon || nReq < sh->fSt.nGroups*2 ) {
         req = waitForClientOrChef();
+        if (req.reqType == DRAINREQ)
+            break;
         switch(req.reqType) {
             case FOODREQ:
                    informChef(req.reqGroup);
@@ -162,8 +175,7 @@ static request waitForClientOrChef()
         } else {
             if (sh->fSt.st.waiterStat != WAIT_FOR_REQUEST) {
                 semDownOrExit(sh->mutex, "pre-WAIT_FOR_REQUEST");
-                    sh->fSt.st.waiterStat = WAIT_FOR_REQUEST;
-                    saveState(nFic, &(sh->fSt));
+                    setWaiterState(WAIT_FOR_REQUEST);
                 semUpOrExit (sh->mutex, "WAIT_FOR_REQUEST & state saved.");
             }
 
@@ -177,7 +189,7 @@ static request waitForClientOrChef()
                 queue[qwrite_next] = incoming;
                 qwrite_next = (qwrite_next + 1) % NUMTABLES;
                 qlength++;
-            } else if (incoming.reqType == FOODREADY) {
+            } else if (incoming.reqType == FOODREADY || incoming.reqType == DRAINREQ) {
                 outgoing = incoming;
             } else {
                 semDownOrExit(sh->mutex, "!!! BUG: Wrong request.");
@@ -203,14 +215,13 @@ static void informChef (int n)
     semDownOrExit(sh->mutex, "pre-INFORM_CHEF");
         sh->fSt.foodGroup = n;
         sh->fSt.foodOrder = true;
-        sh->fSt.st.waiterStat = INFORM_CHEF;
-        saveState(nFic, &(sh->fSt));
+        setWaiterState(INFORM_CHEF);
     semUpOrExit (sh->mutex, "INFORM_CHEF & state saved.");
 
     semUpOrExit(sh->waitOrder, "we have an order for chef");
 
     semDownOrExit(sh->orderReceived, "waiter waits for chef to receive request");
-    int table = sh->fSt.assignedTable[n];
+    int table = GROUPTABLE(sh->fSt, n);
     semUpOrExit(sh->requestReceived[table], "waiter informs that request was received");
 }
 
@@ -228,9 +239,8 @@ static void informChef (int n)
 static void takeFoodToTable (int n)
 {
     semDownOrExit (sh->mutex, "pre-TAKE_TO_TABLE");
-        sh->fSt.st.waiterStat = TAKE_TO_TABLE;
-        saveState(nFic, &(sh->fSt));
-        int table = sh->fSt.assignedTable[n];
+        setWaiterState(TAKE_TO_TABLE);
+        int table = GROUPTABLE(sh->fSt, n);
     semUpOrExit (sh->mutex, "TAKE_TO_TABLE & state saved.");
 
     sh->fSt.foodOrder = false;
@@ -9,12 +9,21 @@
  *     \li destruction of a previously created set of semaphores
  *     \li signalling start of operations
  *     \li <em>down</em> of a semaphore within the set
- *     \li <em>up</em> of a semaphore within the set.
+ *     \li <em>down</em> of a semaphore within the set, waiting at most a given time
+ *     \li <em>up</em> of a semaphore within the set
+ *     \li reading the value of a semaphore within the set
+ *     \li reading the number of processes waiting on a semaphore within the set
+ *     \li registering the contention counters of the set.
  *
  *  \author António Rui Borges - October 1995
  */
 
+#define _GNU_SOURCE
+
 #include <stdio.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/sem.h>
@@ -28,6 +37,35 @@
 /** \brief access permission: user r-w */
 #define  MASK           0600
 
+/** \brief contention counters of the set, indexed by semaphore location (NULL if not accounted) */
+static SEM_STATS *semStats = NULL;
+
+/** \brief number of semaphores whose contention is accounted */
+static unsigned int semStatsNum = 0;
+
+/* internal functions */
+
+static unsigned long semClock (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+static void semAccountBlocked (SEM_STATS *st, unsigned long time)
+{
+  unsigned long max = __atomic_load_n (&st->maxBlockedTime, __ATOMIC_RELAXED);
+
+  __atomic_fetch_add (&st->blocked, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add (&st->blockedTime, time, __ATOMIC_RELAXED);
+  while ((time > max) &&
+         !__atomic_compare_exchange_n (&st->maxBlockedTime, &max, time, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+}
+
+/* external functions */
+
 /**
  *  \brief Creation of a set of semaphores.
  *
@@ -107,6 +145,8 @@ int semSignal (int semgid)
  *  \brief <em>Down</em> of a semaphore within the set.
  *
  *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *  When contention counters are registered, the operation is first tried without blocking, so that only the
+ *  operations that actually block are timed.
  *
  *  \param semgid set identifier
  *  \param sindex semaphore location in the set (1 .. snum)
@@ -118,6 +158,9 @@ int semSignal (int semgid)
 int SEMDOWN (int semgid, unsigned int sindex)
 {
   struct sembuf down = { 0, -1, 0 };                                                      /* specific down operation */
+  SEM_STATS *st;                                                                      /* counters of the semaphore */
+  unsigned long start;                                                          /* time when the operation blocked */
+  int stat;                                                                             /* status of the operation */
 
   // ***DEBUG***
   if (sindex == 0) {
@@ -127,7 +170,66 @@ int SEMDOWN (int semgid, unsigned int sindex)
   // ***/DEBUG***
   assert(sindex>0);
   down.sem_num = (unsigned short) sindex;
-  return semop (semgid, &down, 1);
+  if ((semStats == NULL) || (sindex > semStatsNum))
+     return semop (semgid, &down, 1);
+
+  st = &semStats[sindex];
+  down.sem_flg = IPC_NOWAIT;
+  if ((stat = semop (semgid, &down, 1)) == -1) {
+     if (errno != EAGAIN)
+        return -1;
+     down.sem_flg = 0;
+     start = semClock ();
+     if ((stat = semop (semgid, &down, 1)) == -1)
+        return -1;
+     semAccountBlocked (st, semClock () - start);
+  }
+  __atomic_fetch_add (&st->acquisitions, 1, __ATOMIC_RELAXED);
+
+  return stat;
+}
+
+/**
+ *  \brief <em>Down</em> of a semaphore within the set, waiting at most a given time.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>, or if the
+ *  semaphore could not be decremented within <tt>timeout</tt> (<tt>errno</tt> is then set to <tt>EAGAIN</tt>).
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param timeout longest time the calling process is blocked, in microseconds (0: it is not blocked)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semDownTimed (int semgid, unsigned int sindex, long timeout)
+{
+  struct sembuf down = { 0, -1, IPC_NOWAIT };                                             /* specific down operation */
+  struct timespec ts = { timeout / 1000000, (timeout % 1000000) * 1000 };                     /* longest wait */
+  SEM_STATS *st = NULL;                                                               /* counters of the semaphore */
+  unsigned long start;                                                          /* time when the operation blocked */
+  int stat;                                                                             /* status of the operation */
+
+  assert(sindex>0);
+  down.sem_num = (unsigned short) sindex;
+  if ((semStats != NULL) && (sindex <= semStatsNum))
+     st = &semStats[sindex];
+
+  if ((stat = semop (semgid, &down, 1)) == -1) {
+     if ((errno != EAGAIN) || (timeout <= 0))
+        return -1;
+     down.sem_flg = 0;
+     start = semClock ();
+     if ((stat = semtimedop (semgid, &down, 1, &ts)) == -1)
+        return -1;
+     if (st != NULL)
+        semAccountBlocked (st, semClock () - start);
+  }
+  if (st != NULL)
+     __atomic_fetch_add (&st->acquisitions, 1, __ATOMIC_RELAXED);
+
+  return stat;
 }
 
 /**
@@ -150,3 +252,53 @@ int SEMUP (int semgid, unsigned int sindex)
   up.sem_num = (unsigned short) sindex;
   return semop (semgid, &up, 1);
 }
+
+/**
+ *  \brief Reading the value of a semaphore within the set.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return semaphore value, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semGetValue (int semgid, unsigned int sindex)
+{
+  return semctl (semgid, (int) sindex, GETVAL);
+}
+
+/**
+ *  \brief Reading the number of processes waiting on a semaphore within the set.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return number of processes blocked on a <em>down</em> of the semaphore, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semGetWaiting (int semgid, unsigned int sindex)
+{
+  return semctl (semgid, (int) sindex, GETNCNT);
+}
+
+/**
+ *  \brief Registering the contention counters of the set.
+ *
+ *  From now on, every <em>down</em> carried out by the calling process on semaphore <tt>i</tt> of the set is
+ *  accounted in <tt>stats[i]</tt>. A null pointer stops the accounting.
+ *
+ *  \param stats array of counters, indexed by semaphore location (1 .. snum)
+ *  \param snum number of semaphores in the set
+ */
+
+void semSetStats (SEM_STATS *stats, unsigned int snum)
+{
+  semStats = stats;
+  semStatsNum = (stats == NULL) ? 0 : snum;
+}
@@ -9,7 +9,11 @@
  *     \li destruction of a previously created set of semaphores
  *     \li signalling start of operations
  *     \li <em>down</em> of a semaphore within the set
- *     \li <em>up</em> of a semaphore within the set.
+ *     \li <em>down</em> of a semaphore within the set, waiting at most a given time
+ *     \li <em>up</em> of a semaphore within the set
+ *     \li reading the value of a semaphore within the set
+ *     \li reading the number of processes waiting on a semaphore within the set
+ *     \li registering the contention counters of the set.
  *
  *  \author António Rui Borges - October 1995
  */
@@ -71,6 +75,23 @@ extern int semDestroy (int semgid);
 
 extern int semSignal (int semgid);
 
+/**
+ *  \brief Definition of the contention counters of a semaphore.
+ *
+ *  They are updated with atomic operations, so they may be kept in shared memory and updated by several
+ *  processes.
+ */
+typedef struct {
+    /** \brief number of <em>down</em> operations that have succeeded */
+    unsigned long acquisitions;
+    /** \brief number of <em>down</em> operations that had to block */
+    unsigned long blocked;
+    /** \brief total time spent blocked (in ns) */
+    unsigned long blockedTime;
+    /** \brief longest time spent blocked by a single operation (in ns) */
+    unsigned long maxBlockedTime;
+} SEM_STATS;
+
 #ifdef SEMDEBUG
 #define SEMDOWN semDown_raw
 #define SEMUP semUp_raw
@@ -93,6 +114,22 @@ extern int semSignal (int semgid);
 
 extern int SEMDOWN (int semgid, unsigned int sindex);
 
+/**
+ *  \brief <em>Down</em> of a semaphore within the set, waiting at most a given time.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>, or if the
+ *  semaphore could not be decremented within <tt>timeout</tt> (<tt>errno</tt> is then set to <tt>EAGAIN</tt>).
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param timeout longest time the calling process is blocked, in microseconds (0: it is not blocked)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semDownTimed (int semgid, unsigned int sindex, long timeout);
+
 /**
  *  \brief <em>Up</em> of a semaphore within the set.
  *
@@ -107,4 +144,44 @@ extern int SEMDOWN (int semgid, unsigned int sindex);
 
 extern int SEMUP (int semgid, unsigned int sindex);
 
+/**
+ *  \brief Reading the value of a semaphore within the set.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return semaphore value, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semGetValue (int semgid, unsigned int sindex);
+
+/**
+ *  \brief Reading the number of processes waiting on a semaphore within the set.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return number of processes blocked on a <em>down</em> of the semaphore, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semGetWaiting (int semgid, unsigned int sindex);
+
+/**
+ *  \brief Registering the contention counters of the set.
+ *
+ *  From now on, every <em>down</em> carried out by the calling process on semaphore <tt>i</tt> of the set is
+ *  accounted in <tt>stats[i]</tt>. A null pointer stops the accounting.
+ *
+ *  \param stats array of counters, indexed by semaphore location (1 .. snum)
+ *  \param snum number of semaphores in the set
+ */
+
+extern void semSetStats (SEM_STATS *stats, unsigned int snum);
+
 #endif /* SEMAPHORE_H_ */
@@ -0,0 +1,125 @@
+/**
+ *  \file seqlock.c (implementation file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  \brief Sequence locks: lock-free consistent snapshots of shared data.
+ *
+ *  Defined operations:
+ *     \li start of a write
+ *     \li end of a write
+ *     \li reading a consistent snapshot
+ *     \li start and end of a read of data that is not contiguous.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include <sched.h>
+
+#include "seqlock.h"
+
+/** \brief number of attempts of a reader before giving up a consistent snapshot */
+#define  RETRIES          1000
+
+/**
+ *  \brief Start of a write.
+ *
+ *  \param seq pointer to the sequence counter
+ */
+void seqWriteBegin (unsigned long *seq)
+{
+    __atomic_fetch_add (seq, 1, __ATOMIC_RELAXED);
+    /* the counter becomes odd before any data is changed */
+    __atomic_thread_fence (__ATOMIC_RELEASE);
+}
+
+/**
+ *  \brief End of a write.
+ *
+ *  \param seq pointer to the sequence counter
+ */
+void seqWriteEnd (unsigned long *seq)
+{
+    __atomic_fetch_add (seq, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ *  \brief Reading a consistent snapshot.
+ *
+ *  The copy is retried while a write is in progress or took place during the copy. If no consistent copy
+ *  could be made after a bounded number of attempts (for instance, because the writer was killed in the
+ *  middle of a write), the last copy is kept.
+ *
+ *  \param seq pointer to the sequence counter
+ *  \param dst pointer to the snapshot
+ *  \param src pointer to the shared data
+ *  \param size size of the shared data (in bytes)
+ *
+ *  \return \c true, if the snapshot is consistent
+ *  \return \c false, otherwise
+ */
+bool seqRead (const unsigned long *seq, void *dst, const void *src, size_t size)
+{
+    unsigned long before, after;
+    int n;
+
+    for (n = 0; n < RETRIES; n++) {
+        before = __atomic_load_n (seq, __ATOMIC_ACQUIRE);
+        if ((before & 1) == 0) {
+            memcpy (dst, src, size);
+            /* the copy is complete before the counter is read again */
+            __atomic_thread_fence (__ATOMIC_ACQUIRE);
+            after = __atomic_load_n (seq, __ATOMIC_RELAXED);
+            if (before == after)
+                return true;
+        }
+        /* lets the writer, which holds the critical region, make progress */
+        sched_yield ();
+    }
+    memcpy (dst, src, size);
+
+    return false;
+}
+
+/**
+ *  \brief Start of a read of data that is not contiguous.
+ *
+ *  The calling process waits until no write is in progress, for the same bounded number of attempts as
+ *  <tt>seqRead</tt>. The data is then read and the read is ended by <tt>seqReadRetry</tt>.
+ *
+ *  \param seq pointer to the sequence counter
+ *
+ *  \return value of the counter, to be given to <tt>seqReadRetry</tt>
+ */
+unsigned long seqReadBegin (const unsigned long *seq)
+{
+    unsigned long val;
+    int n;
+
+    for (n = 0; n < RETRIES; n++) {
+        if (((val = __atomic_load_n (seq, __ATOMIC_ACQUIRE)) & 1) == 0)
+            return val;
+        sched_yield ();
+    }
+
+    return val;
+}
+
+/**
+ *  \brief End of a read of data that is not contiguous.
+ *
+ *  A read that started while a write was in progress is accepted if the counter did not change since, so that
+ *  a writer killed in the middle of a write does not keep its readers retrying.
+ *
+ *  \param seq pointer to the sequence counter
+ *  \param start value returned by <tt>seqReadBegin</tt>
+ *
+ *  \return \c true, if a write took place during the read, which must then be carried out again
+ *  \return \c false, otherwise
+ */
+bool seqReadRetry (const unsigned long *seq, unsigned long start)
+{
+    /* the data is read before the counter is read again */
+    __atomic_thread_fence (__ATOMIC_ACQUIRE);
+    return __atomic_load_n (seq, __ATOMIC_RELAXED) != start;
+}
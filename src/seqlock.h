@@ -0,0 +1,80 @@
+/**
+ *  \file seqlock.h (interface file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  \brief Sequence locks: lock-free consistent snapshots of shared data.
+ *
+ *  A sequence counter is associated to a block of shared data. A writer, which must already exclude any other
+ *  writer, makes the counter odd before changing the data and even again afterwards. A reader copies the data
+ *  and retries whenever the counter was odd or changed during the copy, so it never blocks a writer.
+ *
+ *  Defined operations:
+ *     \li start of a write
+ *     \li end of a write
+ *     \li reading a consistent snapshot
+ *     \li start and end of a read of data that is not contiguous.
+ */
+
+#ifndef SEQLOCK_H_
+#define SEQLOCK_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ *  \brief Start of a write.
+ *
+ *  \param seq pointer to the sequence counter
+ */
+extern void seqWriteBegin (unsigned long *seq);
+
+/**
+ *  \brief End of a write.
+ *
+ *  \param seq pointer to the sequence counter
+ */
+extern void seqWriteEnd (unsigned long *seq);
+
+
+/**
+ *  \brief Reading a consistent snapshot.
+ *
+ *  The copy is retried while a write is in progress or took place during the copy. If no consistent copy
+ *  could be made after a bounded number of attempts (for instance, because the writer was killed in the
+ *  middle of a write), the last copy is kept.
+ *
+ *  \param seq pointer to the sequence counter
+ *  \param dst pointer to the snapshot
+ *  \param src pointer to the shared data
+ *  \param size size of the shared data (in bytes)
+ *
+ *  \return \c true, if the snapshot is consistent
+ *  \return \c false, otherwise
+ */
+extern bool seqRead (const unsigned long *seq, void *dst, const void *src, size_t size);
+
+/**
+ *  \brief Start of a read of data that is not contiguous.
+ *
+ *  The calling process waits until no write is in progress, for the same bounded number of attempts as
+ *  <tt>seqRead</tt>. The data is then read and the read is ended by <tt>seqReadRetry</tt>.
+ *
+ *  \param seq pointer to the sequence counter
+ *
+ *  \return value of the counter, to be given to <tt>seqReadRetry</tt>
+ */
+extern unsigned long seqReadBegin (const unsigned long *seq);
+
+/**
+ *  \brief End of a read of data that is not contiguous.
+ *
+ *  \param seq pointer to the sequence counter
+ *  \param start value returned by <tt>seqReadBegin</tt>
+ *
+ *  \return \c true, if a write took place during the read, which must then be carried out again
+ *  \return \c false, otherwise
+ */
+extern bool seqReadRetry (const unsigned long *seq, unsigned long start);
+
+#endif /* SEQLOCK_H_ */
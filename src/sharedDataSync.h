@@ -17,13 +17,35 @@
 #ifndef SHAREDDATASYNC_H_
 #define SHAREDDATASYNC_H_
 
+#include <string.h>
+
 #include "probConst.h"
 #include "probDataStruct.h"
+#include "waitForGraph.h"
+#include "trace.h"
+#include "histogram.h"
+#include "semaphore.h"
+#include "seqlock.h"
+#include "logging.h"
+#include "workload.h"
+
+/** \brief largest number of semaphores in the set */
+#define SEM_MAXNU            ( 7 + MAXGROUPS + 3*NUMTABLES )
 
 
 // By the students.
 #include "semDebug_sharedDataSync.h"
 
+#ifdef STATELOCKS
+/**
+ *  \brief Definition of a sequence counter on a cache line of its own.
+ */
+typedef struct {
+    /** \brief sequence counter */
+    unsigned long val __attribute__ ((aligned (CACHELINE)));
+} SEQ_COUNTER;
+#endif
+
 /**
  *  \brief Definition of <em>shared information</em> data type.
  */
@@ -33,7 +55,7 @@ typedef struct
 
           /* semaphores ids */
           /** \brief identification of critical region protection semaphore – val = 1 */
-          unsigned int mutex;
+          unsigned int mutex ALIGNED;
           /** \brief identification of semaphore used by receptionist to wait for groups - val = 0 */
           unsigned int receptionistReq;
           /** \brief identification of semaphore used by groups to wait before issuing receptionist request - val = 1 */
@@ -54,8 +76,81 @@ typedef struct
           unsigned int foodArrived[NUMTABLES];
           /** \brief identification of semaphore used by groups to wait for payment completed – val = 0 */
           unsigned int tableDone[NUMTABLES];
+
+          /** \brief number of state transitions carried out so far (progress indicator used by the watchdog) */
+          unsigned long progress ALIGNED;
+          /** \brief wait-for graph used for online deadlock detection */
+          WAIT_FOR_GRAPH wfg ALIGNED;
+          /** \brief name of the trace file (empty if tracing is disabled) */
+          char traceFile[TRACE_NAMELEN] ALIGNED;
+
+          /** \brief time spent by the groups in each state */
+          HISTOGRAM groupStateTime[LEAVING+1] ALIGNED;
+          /** \brief time spent by the chef in each state */
+          HISTOGRAM chefStateTime[REST+1] ALIGNED;
+          /** \brief time spent by the waiter in each state */
+          HISTOGRAM waiterStateTime[TAKE_TO_TABLE+1] ALIGNED;
+          /** \brief time spent by the receptionist in each state */
+          HISTOGRAM receptionistStateTime[RECVPAY+1] ALIGNED;
+          /** \brief statistics of the groups (each group updates its own entries) */
+          GROUP_STATS groupStats ALIGNED;
+
+          /** \brief contention counters of the semaphores, indexed by semaphore location */
+          SEM_STATS semStats[SEM_MAXNU+1] ALIGNED;
+
+          /** \brief sequence counter of the full state of the problem, odd while it is being changed under the
+           *  protection of <tt>mutex</tt>, so observers can take consistent snapshots without it (seqlock.h; not
+           *  used with <tt>STATELOCKS</tt>, see <tt>entitySeq</tt>) */
+          unsigned long stateSeq ALIGNED;
+
+          /** \brief if the intervening entities should fault the pages of the region in before they start */
+          bool prefault;
+          /** \brief if the state transitions are logged as delta records instead of full state lines */
+          bool deltaLog;
+          /** \brief table of each group in the last line of the logging file (kept up to date in delta mode) */
+          TABLE_ID loggedTable[MAXGROUPS];
+          /** \brief if the logging file is memory mapped by all the entities */
+          bool logMapped;
+          /** \brief write cursor of the memory mapped logging file (length of the lines written) */
+          LOG_CURSOR logCursor ALIGNED;
+          /** \brief if each entity logs to its own shard of the logging file */
+          bool logShards;
+          /** \brief sequence counter of the lines of the shards, which sets their global order */
+          unsigned long logSeq ALIGNED;
+          /** \brief if the groups keep coming back until the main process drains the restaurant (daemon mode) */
+          bool daemon;
+          /** \brief if the groups must not start a new visit (set by the main process to drain the restaurant) */
+          bool draining;
+          /** \brief number of visits completed by the groups */
+          unsigned long visits ALIGNED;
+          /** \brief admission control: maximum number of waiting groups (0 if unlimited) */
+          int admitQueue;
+          /** \brief admission control: maximum estimated wait of a new group (in microseconds, 0 if unlimited) */
+          long admitWait;
+          /** \brief initial back-off of a group that was turned away (in microseconds) */
+          long admitBackoff;
+          /** \brief if the last table request of each group was turned away (set by the receptionist) */
+          bool turnedAway[MAXGROUPS];
+          /** \brief number of table requests turned away */
+          unsigned long turnedAwayCount;
+          /** \brief wait predicted by the receptionist for each group on its last table request (in us) */
+          long expectedWait[MAXGROUPS];
+          /** \brief number of orders the chef cooks at the same time (1: one order at a time, as the reference chef) */
+          int chefStations;
+          /** \brief name of the record file of the receptionist (empty if it does not keep records) */
+          char recFile[RECORD_NAMELEN];
+          /** \brief arrivals of the visits of the groups after their first one (daemon mode) */
+          ARRIVAL_QUEUE arrivals ALIGNED;
+#ifdef STATELOCKS
+          /** \brief sequence counter of the fields owned by each entity (indexed by its node of the wait-for
+           *  graph), odd while the entity changes them: its state word and, for the waiter, the food order and, for
+           *  the receptionist, the tables of the groups, the number of groups waiting and the predicted waits */
+          SEQ_COUNTER entitySeq[WFG_NODES];
+          /** \brief state transitions waiting for their lines to be written, in their global order */
+          LOG_QUEUE logQueue ALIGNED;
+#endif
 #ifdef SEMDEBUG
-          struct semdebug debug;
+          struct semdebug debug ALIGNED;
 #endif
 
         } SHARED_DATA;
@@ -75,4 +170,50 @@ typedef struct
 #define REQUESTRECEIVED        (FOODARRIVED+NUMTABLES)
 #define TABLEDONE              (REQUESTRECEIVED+NUMTABLES)
 
+/**
+ *  \brief Taking a snapshot of the full state of the problem without entering the critical region.
+ *
+ *  The snapshot is consistent as a whole, or, with <tt>STATELOCKS</tt>, for the fields of each entity, since
+ *  the entities do not exclude each other then.
+ *
+ *  \param sh pointer to shared memory region
+ *  \param fSt pointer to the snapshot
+ */
+static inline void stateSnapshot (SHARED_DATA *sh, FULL_STAT *fSt)
+{
+#ifndef STATELOCKS
+    seqRead (&sh->stateSeq, fSt, &sh->fSt, sizeof (FULL_STAT));
+#else
+    unsigned long seq;
+    int e, g;
+
+    memcpy (fSt, &sh->fSt, sizeof (FULL_STAT));
+    for (e = 0; e < WFG_NODES; e++) {
+        if ((e >= sh->fSt.nGroups) && (e < MAXGROUPS))
+            continue;
+        do {
+            seq = seqReadBegin (&sh->entitySeq[e].val);
+            switch (e) {
+                case WFG_CHEF:
+                    fSt->st.chefStat = sh->fSt.st.chefStat;
+                    break;
+                case WFG_WAITER:
+                    fSt->st.waiterStat = sh->fSt.st.waiterStat;
+                    fSt->foodOrder = sh->fSt.foodOrder;
+                    fSt->foodGroup = sh->fSt.foodGroup;
+                    break;
+                case WFG_RECEPTIONIST:
+                    fSt->st.receptionistStat = sh->fSt.st.receptionistStat;
+                    fSt->groupsWaiting = sh->fSt.groupsWaiting;
+                    for (g = 0; g < sh->fSt.nGroups; g++)
+                        GROUPTABLE (*fSt, g) = GROUPTABLE (sh->fSt, g);
+                    break;
+                default:
+                    GROUPSTAT (fSt->st, e) = GROUPSTAT (sh->fSt.st, e);
+            }
+        } while (seqReadRetry (&sh->entitySeq[e].val, seq));
+    }
+#endif
+}
+
 #endif /* SHAREDDATASYNC_H_ */
@@ -5,21 +5,84 @@
  *
  *   Operations defined on shared memory:
  *      \li creation of a new block
+ *      \li creation of a new block backed by huge pages
+ *      \li creation of a new block backed by an anonymous memory file
  *      \li connection to a previously created block
  *      \li destruction of a previously created block
  *      \li mapping of the block previously created on the process address space
- *      \li unmapping of the block off the process address space.
+ *      \li read-only mapping of the block previously created on the process address space
+ *      \li unmapping of the block off the process address space
+ *      \li pre-faulting a mapped block
+ *      \li locking a mapped block in memory.
  *
  *  \author António Rui Borges - October 1995
  */
 
+#define _GNU_SOURCE
+
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
 #include <sys/types.h>
 #include <sys/shm.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "sharedMemory.h"
 
 /** \brief access permission: user r-w */
 #define  MASK           0600
 
+/** \brief huge page size assumed when the system does not report it (in bytes) */
+#define  HUGEPAGE       (2UL * 1024 * 1024)
+
+/** \brief file descriptor of the block backed by an anonymous memory file (-1 if none is used) */
+static int fdBlock = -1;
+
+/** \brief local address of the block backed by an anonymous memory file (NULL if not mapped) */
+static void *fdAdd = NULL;
+
+/** \brief mapped size of the block backed by an anonymous memory file */
+static size_t fdSize = 0;
+
+/* internal functions */
+
+static unsigned long hugePageSize (void)
+{
+  FILE *fic;                                                                                   /* system information */
+  char line[100];                                                                                      /* read line */
+  unsigned long kB;                                                                          /* huge page size in kB */
+
+  if ((fic = fopen ("/proc/meminfo", "r")) == NULL)
+     return HUGEPAGE;
+  while (fgets (line, sizeof (line), fic) != NULL)
+    if (sscanf (line, "Hugepagesize: %lu kB", &kB) == 1)
+       { fclose (fic);
+         return kB * 1024;
+       }
+  fclose (fic);
+  return HUGEPAGE;
+}
+
+static int mapFd (int prot, void **pAttAdd)
+{
+  struct stat st;                                                                                /* file status */
+  void *add;                                                                                    /* temporary pointer */
+
+  if (fstat (fdBlock, &st) == -1)
+     return -1;
+  add = mmap (NULL, (size_t) st.st_size, prot, MAP_SHARED | MAP_POPULATE, fdBlock, 0);
+  if (add == MAP_FAILED)
+     return -1;
+  fdAdd = *pAttAdd = add;
+  fdSize = (size_t) st.st_size;
+  return 0;
+}
+
+/* external functions */
+
 /**
  *  \brief Creation of a new block.
  *
@@ -37,9 +100,94 @@ int shmemCreate (int key, unsigned int size)
   return shmget ((key_t) key, size, MASK | IPC_CREAT | IPC_EXCL);
 }
 
+/**
+ *  \brief Creation of a new block backed by huge pages.
+ *
+ *  The size of the block is rounded up to a multiple of the huge page size. If the system can not provide the
+ *  huge pages (none are reserved, or the process lacks the privilege), a block of normal pages is created
+ *  instead. The function fails if there is already a block of shared memory with a creation key equal to
+ *  <tt>key</tt>.
+ *
+ *  \param key creation key
+ *  \param size block size (in bytes)
+ *  \param pHuge pointer to the location where it is stored if the block is backed by huge pages
+ *
+ *  \return block identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemCreateHuge (int key, unsigned int size, bool *pHuge)
+{
+  unsigned long hsize = hugePageSize ();                                                          /* huge page size */
+  int shmid;                                                                                   /* block identifier */
+
+  *pHuge = false;
+  shmid = shmget ((key_t) key, (size + hsize - 1) / hsize * hsize, MASK | IPC_CREAT | IPC_EXCL | SHM_HUGETLB);
+  if (shmid != -1)
+     { *pHuge = true;
+       return shmid;
+     }
+  if (errno == EEXIST)
+     return -1;
+  return shmemCreate (key, size);
+}
+
+/**
+ *  \brief Creation of a new block backed by an anonymous memory file.
+ *
+ *  The block is not named by a key: its file descriptor is inherited by the child processes, even across
+ *  <tt>exec</tt>, and made known to them through the environment variable <tt>SHMEM_FD_ENV</tt>, so that
+ *  <tt>shmemConnect</tt> returns it. The memory is released as soon as the last process holding the
+ *  descriptor or a mapping terminates, even if it crashes. The pages are populated upon mapping.
+ *
+ *  \param size block size (in bytes)
+ *  \param huge if the block should be backed by huge pages (normal pages are used if they are not available)
+ *  \param pHuge pointer to the location where it is stored if the block is backed by huge pages
+ *
+ *  \return block identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemCreateFd (unsigned int size, bool huge, bool *pHuge)
+{
+  unsigned long hsize = hugePageSize ();                                                          /* huge page size */
+  char num[12];                                                                        /* numeric value conversion */
+  size_t hsz = (size + hsize - 1) / hsize * hsize;                                 /* size rounded to huge pages */
+  int fd = -1;                                                                                 /* file descriptor */
+  void *add;                                                                                    /* temporary pointer */
+
+  *pHuge = false;
+  if (huge && ((fd = memfd_create ("restaurant", MFD_HUGETLB)) != -1))
+     { /* the huge pages are only reserved upon mapping */
+       if ((ftruncate (fd, hsz) == 0) &&
+           ((add = mmap (NULL, hsz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) != MAP_FAILED))
+          { munmap (add, hsz);
+            *pHuge = true;
+          }
+          else { close (fd);
+                 fd = -1;
+               }
+     }
+  if (fd == -1)
+     { if ((fd = memfd_create ("restaurant", 0)) == -1)
+          return -1;
+       if (ftruncate (fd, size) == -1)
+          { close (fd);
+            return -1;
+          }
+     }
+  sprintf (num, "%d", fd);
+  if (setenv (SHMEM_FD_ENV, num, 1) == -1)
+     { close (fd);
+       return -1;
+     }
+  return fdBlock = fd;
+}
+
 /**
  *  \brief Connection to a previously created block.
  *
+ *  If the block of the parent process is backed by an anonymous memory file, it is the one returned.
  *  The function fails if there is no block with a creation key equal to <tt>key</tt>.
  *
  *  \param key creation key
@@ -50,6 +198,10 @@ int shmemCreate (int key, unsigned int size)
 
 int shmemConnect (int key)
 {
+  char *fd = getenv (SHMEM_FD_ENV);                                       /* inherited file descriptor, if any */
+
+  if (fd != NULL)
+     return fdBlock = atoi (fd);
   return shmget ((key_t) key, 1, MASK);
 }
 
@@ -66,6 +218,11 @@ int shmemConnect (int key)
 
 int shmemDestroy (int shmid)
 {
+  if ((fdBlock != -1) && (shmid == fdBlock))
+     { fdBlock = -1;
+       unsetenv (SHMEM_FD_ENV);
+       return close (shmid);
+     }
   return shmctl (shmid, IPC_RMID, (struct shmid_ds *) NULL);
 }
 
@@ -85,6 +242,8 @@ int shmemAttach (int shmid, void **pAttAdd)
 {
   void *add;                                                                                    /* temporary pointer */
 
+  if ((fdBlock != -1) && (shmid == fdBlock))
+     return mapFd (PROT_READ | PROT_WRITE, pAttAdd);
   add = shmat (shmid, (char *) NULL, 0);
   if (add != (void *) -1)
      { *pAttAdd = (void *) add;
@@ -93,6 +252,33 @@ int shmemAttach (int shmid, void **pAttAdd)
      else return 1;
 }
 
+/**
+ *  \brief Read-only mapping of the block previously created on the process address space.
+ *
+ *  Any attempt of the process to write on the block raises a segmentation fault.
+ *  The function fails if there is no block with an identifier equal to <tt>shmid</tt>.
+ *
+ *  \param shmid block identifier
+ *  \param pAttAdd pointer to the location where the local address of the attached block is stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemAttachReadOnly (int shmid, void **pAttAdd)
+{
+  void *add;                                                                                    /* temporary pointer */
+
+  if ((fdBlock != -1) && (shmid == fdBlock))
+     return mapFd (PROT_READ, pAttAdd);
+  add = shmat (shmid, (char *) NULL, SHM_RDONLY);
+  if (add != (void *) -1)
+     { *pAttAdd = (void *) add;
+       return 0;
+     }
+     else return -1;
+}
+
 /**
  *  \brief Unmapping of the block off the process address space.
  *
@@ -107,5 +293,51 @@ int shmemAttach (int shmid, void **pAttAdd)
 
 int shmemDettach (void *attAdd)
 {
+  if ((fdAdd != NULL) && (attAdd == fdAdd))
+     { fdAdd = NULL;
+       return munmap (attAdd, fdSize);
+     }
   return shmdt (attAdd);
 }
+
+/**
+ *  \brief Pre-faulting a mapped block.
+ *
+ *  Every page of the block is touched, so that no page fault occurs later when the process accesses it.
+ *  Writing the pages also allocates them, but must only be done before the block is shared with other
+ *  processes; reading them just maps them on the process address space.
+ *
+ *  \param attAdd local address of the attached block
+ *  \param size block size (in bytes)
+ *  \param write if the pages are to be written (the values they hold are kept)
+ */
+
+void shmemPrefault (void *attAdd, unsigned int size, bool write)
+{
+  volatile char *p = (volatile char *) attAdd;                                         /* pointer to the block */
+  long psize = sysconf (_SC_PAGESIZE);                                                               /* page size */
+  unsigned int n;                                                                            /* counting variable */
+
+  for (n = 0; n < size; n += psize)
+    if (write)
+       p[n] = p[n];
+       else (void) p[n];
+}
+
+/**
+ *  \brief Locking a mapped block in memory.
+ *
+ *  The pages of the block are made resident and will not be paged out. The function fails if the process
+ *  lacks the privilege or exceeds its limit of locked memory (<tt>RLIMIT_MEMLOCK</tt>).
+ *
+ *  \param attAdd local address of the attached block
+ *  \param size block size (in bytes)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemLock (void *attAdd, unsigned int size)
+{
+  return mlock (attAdd, size);
+}
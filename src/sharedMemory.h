@@ -5,10 +5,15 @@
  *
  *   Operations defined on shared memory:
  *      \li creation of a new block
+ *      \li creation of a new block backed by huge pages
+ *      \li creation of a new block backed by an anonymous memory file
  *      \li connection to a previously created block
  *      \li destruction of a previously created block
  *      \li mapping of the block previously created on the process address space
- *      \li unmapping of the block off the process address space.
+ *      \li read-only mapping of the block previously created on the process address space
+ *      \li unmapping of the block off the process address space
+ *      \li pre-faulting a mapped block
+ *      \li locking a mapped block in memory.
  *
  *  \author António Rui Borges - October 1995
  */
@@ -16,6 +21,11 @@
 #ifndef SHAREDMEMORY_H_
 #define SHAREDMEMORY_H_
 
+#include <stdbool.h>
+
+/** \brief environment variable holding the file descriptor of a block backed by an anonymous memory file */
+#define  SHMEM_FD_ENV   "RESTAURANT_SHMEM_FD"
+
 /**
  *  \brief Creation of a new block.
  *
@@ -30,9 +40,46 @@
 
 extern int shmemCreate (int key, unsigned int size);
 
+/**
+ *  \brief Creation of a new block backed by huge pages.
+ *
+ *  The size of the block is rounded up to a multiple of the huge page size. If the system can not provide the
+ *  huge pages (none are reserved, or the process lacks the privilege), a block of normal pages is created
+ *  instead. The function fails if there is already a block of shared memory with a creation key equal to
+ *  <tt>key</tt>.
+ *
+ *  \param key creation key
+ *  \param size block size (in bytes)
+ *  \param pHuge pointer to the location where it is stored if the block is backed by huge pages
+ *
+ *  \return block identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int shmemCreateHuge (int key, unsigned int size, bool *pHuge);
+
+/**
+ *  \brief Creation of a new block backed by an anonymous memory file.
+ *
+ *  The block is not named by a key: its file descriptor is inherited by the child processes, even across
+ *  <tt>exec</tt>, and made known to them through the environment variable <tt>SHMEM_FD_ENV</tt>, so that
+ *  <tt>shmemConnect</tt> returns it. The memory is released as soon as the last process holding the
+ *  descriptor or a mapping terminates, even if it crashes. The pages are populated upon mapping.
+ *
+ *  \param size block size (in bytes)
+ *  \param huge if the block should be backed by huge pages (normal pages are used if they are not available)
+ *  \param pHuge pointer to the location where it is stored if the block is backed by huge pages
+ *
+ *  \return block identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int shmemCreateFd (unsigned int size, bool huge, bool *pHuge);
+
 /**
  *  \brief Connection to a previously created block.
  *
+ *  If the block of the parent process is backed by an anonymous memory file, it is the one returned.
  *  The function fails if there is no block with a creation key equal to <tt>key</tt>.
  *
  *  \param key creation key
@@ -70,6 +117,21 @@ extern int shmemDestroy (int shmid);
 
 extern int shmemAttach (int shmid, void **pAttAdd);
 
+/**
+ *  \brief Read-only mapping of the block previously created on the process address space.
+ *
+ *  Any attempt of the process to write on the block raises a segmentation fault.
+ *  The function fails if there is no block with an identifier equal to <tt>shmid</tt>.
+ *
+ *  \param shmid block identifier
+ *  \param pAttAdd pointer to the location where the local address of the attached block is stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int shmemAttachReadOnly (int shmid, void **pAttAdd);
+
 /**
  *  \brief Unmapping of the block off the process address space.
  *
@@ -84,4 +146,33 @@ extern int shmemAttach (int shmid, void **pAttAdd);
 
 extern int shmemDettach (void *attAdd);
 
+/**
+ *  \brief Pre-faulting a mapped block.
+ *
+ *  Every page of the block is touched, so that no page fault occurs later when the process accesses it.
+ *  Writing the pages also allocates them, but must only be done before the block is shared with other
+ *  processes; reading them just maps them on the process address space.
+ *
+ *  \param attAdd local address of the attached block
+ *  \param size block size (in bytes)
+ *  \param write if the pages are to be written (the values they hold are kept)
+ */
+
+extern void shmemPrefault (void *attAdd, unsigned int size, bool write);
+
+/**
+ *  \brief Locking a mapped block in memory.
+ *
+ *  The pages of the block are made resident and will not be paged out. The function fails if the process
+ *  lacks the privilege or exceeds its limit of locked memory (<tt>RLIMIT_MEMLOCK</tt>).
+ *
+ *  \param attAdd local address of the attached block
+ *  \param size block size (in bytes)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int shmemLock (void *attAdd, unsigned int size);
+
 #endif /* SHAREDMEMORY_H_ */
@@ -0,0 +1,234 @@
+/**
+ *  \file trace.c (implementation file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  \brief Timeline tracing of the intervening entities into a Chrome Trace Event file.
+ *
+ *  Defined operations:
+ *     \li file initialization
+ *     \li file completion
+ *     \li start of tracing in a process
+ *     \li recording the begin of an operation
+ *     \li recording the end of an operation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+/** \brief size of the events buffer of each process */
+#define  BUFSIZE           65536
+
+/** \brief maximum size of a single event */
+#define  EVENTSIZE           256
+
+/** \brief trace file descriptor (-1 if tracing is disabled) */
+static int fd = -1;
+
+/** \brief process id of the calling process */
+static int pid;
+
+/** \brief buffered events, made of whole lines */
+static char buf[BUFSIZE];
+
+/** \brief number of buffered bytes */
+static size_t len;
+
+/** \brief set while the buffer is being changed, so that a SIGTERM is only handled once it is consistent */
+static volatile sig_atomic_t busy = 0;
+
+/** \brief set when a SIGTERM arrived while the buffer was being changed */
+static volatile sig_atomic_t termPending = 0;
+
+/* internal functions */
+
+/* writes the buffered events; only async-signal-safe calls, so it may run in the SIGTERM handler */
+static bool writeBuffer (void)
+{
+    size_t done = 0;
+    ssize_t n;
+
+    while (done < len) {
+        if ((n = write (fd, buf + done, len - done)) == -1)
+            return false;
+        done += (size_t) n;
+    }
+    len = 0;
+    return true;
+}
+
+/* flushes the buffer and terminates the process with the default action of SIGTERM */
+static void flushAndTerminate (void)
+{
+    writeBuffer ();
+    signal (SIGTERM, SIG_DFL);
+    raise (SIGTERM);
+}
+
+/* the main process terminates the entities with SIGTERM when it detects a deadlock: the blocked processes,
+   the very ones the trace is meant to explain, would lose their events */
+static void onTerminate (int sig)
+{
+    if (busy)
+        termPending = 1;
+    else flushAndTerminate ();
+}
+
+static void flush (void)
+{
+    if (!writeBuffer ()) {
+        perror ("error on writing the trace file");
+        exit (EXIT_FAILURE);
+    }
+}
+
+static void flushAtExit (void)
+{
+    if (fd != -1) {
+        flush ();
+        close (fd);
+        fd = -1;
+    }
+}
+
+static double now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void event (const char *cat, const char *name, char ph)
+{
+    if (fd == -1)
+        return;
+
+    busy = 1;
+    if (len + EVENTSIZE > BUFSIZE)
+        flush ();
+    len += snprintf (buf + len, EVENTSIZE, "{\"name\":\"%.100s\",\"cat\":\"%.20s\",\"ph\":\"%c\","
+                                           "\"ts\":%.3f,\"pid\":%d,\"tid\":%d},\n",
+                     name, cat, ph, now (), pid, pid);
+    busy = 0;
+    if (termPending)
+        flushAndTerminate ();
+}
+
+static void writeOrExit (char nFic[], const char *mode, const char *text)
+{
+    FILE *fic;
+
+    if ((fic = fopen (nFic, mode)) == NULL) {
+        perror ("error on opening the trace file");
+        exit (EXIT_FAILURE);
+    }
+    fputs (text, fic);
+    if (fclose (fic) == EOF) {
+        perror ("error on closing the trace file");
+        exit (EXIT_FAILURE);
+    }
+}
+
+/* external functions */
+
+/**
+ *  \brief File initialization.
+ *
+ *  The function creates the trace file and writes its header.
+ *  If <tt>nFic</tt> is a null pointer or a null string, tracing is disabled.
+ *
+ *  \param nFic name of the trace file
+ */
+void traceCreate (char nFic[])
+{
+    if ((nFic == NULL) || (strlen (nFic) == 0))
+        return;
+
+    writeOrExit (nFic, "w", "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+}
+
+/**
+ *  \brief File completion.
+ *
+ *  The function closes the array of events. It must be called after all traced processes have terminated.
+ *
+ *  \param nFic name of the trace file
+ */
+void traceFinish (char nFic[])
+{
+    char text[EVENTSIZE];
+
+    if ((nFic == NULL) || (strlen (nFic) == 0))
+        return;
+
+    /* the last element carries no trailing comma */
+    snprintf (text, EVENTSIZE, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+                               "\"args\":{\"name\":\"main\"}}\n]}\n", getpid (), getpid ());
+    writeOrExit (nFic, "a", text);
+}
+
+/**
+ *  \brief Start of tracing in the calling process.
+ *
+ *  If <tt>nFic</tt> is a null pointer or a null string, tracing stays disabled and the other operations do
+ *  nothing. The buffered events are flushed when the process terminates, also when it is terminated by
+ *  <tt>SIGTERM</tt>.
+ *
+ *  \param nFic name of the trace file
+ *  \param name name shown for the process in the timeline
+ */
+void traceOpen (char nFic[], const char *name)
+{
+    if ((nFic == NULL) || (strlen (nFic) == 0))
+        return;
+
+    if ((fd = open (nFic, O_WRONLY | O_APPEND)) == -1) {
+        perror ("error on opening the trace file");
+        exit (EXIT_FAILURE);
+    }
+    pid = getpid ();
+    atexit (flushAtExit);
+    signal (SIGTERM, onTerminate);
+
+    len += snprintf (buf + len, EVENTSIZE, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+                                           "\"args\":{\"name\":\"%.100s\"}},\n", pid, pid, name);
+}
+
+/**
+ *  \brief Tells if tracing is enabled in the calling process.
+ */
+bool traceEnabled (void)
+{
+    return fd != -1;
+}
+
+/**
+ *  \brief Recording the begin of an operation.
+ *
+ *  \param cat category of the operation
+ *  \param name name of the operation
+ */
+void traceBegin (const char *cat, const char *name)
+{
+    event (cat, name, 'B');
+}
+
+/**
+ *  \brief Recording the end of an operation.
+ *
+ *  \param cat category of the operation
+ *  \param name name of the operation
+ */
+void traceEnd (const char *cat, const char *name)
+{
+    event (cat, name, 'E');
+}
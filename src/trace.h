@@ -0,0 +1,84 @@
+/**
+ *  \file trace.h (interface file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  \brief Timeline tracing of the intervening entities into a Chrome Trace Event file.
+ *
+ *  The trace file is a JSON object whose <tt>traceEvents</tt> array holds the begin and end events of
+ *  the blocking operations, the log writes and the life cycle phases of all processes, with timestamps in
+ *  microseconds taken from the monotonic clock. It can be opened in <tt>chrome://tracing</tt> or in Perfetto.
+ *
+ *  Each process keeps its events in a private buffer which is appended to the file, as whole lines,
+ *  when it fills up and when the process terminates (normally or by <tt>SIGTERM</tt>, as the entities do when
+ *  the main process detects a deadlock).
+ *
+ *  Defined operations:
+ *     \li file initialization
+ *     \li file completion
+ *     \li start of tracing in a process
+ *     \li recording the begin of an operation
+ *     \li recording the end of an operation.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdbool.h>
+
+/** \brief maximum length of the trace file name */
+#define  TRACE_NAMELEN      51
+
+/**
+ *  \brief File initialization.
+ *
+ *  The function creates the trace file and writes its header.
+ *  If <tt>nFic</tt> is a null pointer or a null string, tracing is disabled.
+ *
+ *  \param nFic name of the trace file
+ */
+extern void traceCreate (char nFic[]);
+
+/**
+ *  \brief File completion.
+ *
+ *  The function closes the array of events. It must be called after all traced processes have terminated.
+ *
+ *  \param nFic name of the trace file
+ */
+extern void traceFinish (char nFic[]);
+
+/**
+ *  \brief Start of tracing in the calling process.
+ *
+ *  If <tt>nFic</tt> is a null pointer or a null string, tracing stays disabled and the other operations do
+ *  nothing. The buffered events are flushed when the process terminates, also when it is terminated by
+ *  <tt>SIGTERM</tt>.
+ *
+ *  \param nFic name of the trace file
+ *  \param name name shown for the process in the timeline
+ */
+extern void traceOpen (char nFic[], const char *name);
+
+/**
+ *  \brief Tells if tracing is enabled in the calling process.
+ */
+extern bool traceEnabled (void);
+
+/**
+ *  \brief Recording the begin of an operation.
+ *
+ *  \param cat category of the operation
+ *  \param name name of the operation
+ */
+extern void traceBegin (const char *cat, const char *name);
+
+/**
+ *  \brief Recording the end of an operation.
+ *
+ *  \param cat category of the operation
+ *  \param name name of the operation
+ */
+extern void traceEnd (const char *cat, const char *name);
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,192 @@
+/**
+ *  \file waitForGraph.c (implementation file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  Online deadlock detection based on a wait-for graph kept in shared memory.
+ *
+ *  Defined operations:
+ *     \li recording that an entity is about to block on a semaphore
+ *     \li recording that an entity is no longer blocked
+ *     \li searching for deadlocked entities
+ *     \li confirmation of a deadlock against the kernel view of the semaphore set.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "probConst.h"
+#include "semaphore.h"
+#include "waitForGraph.h"
+
+/* internal functions */
+
+static bool isLive (const WAIT_FOR_GRAPH *wfg, int nGroups, int n)
+{
+    return ((n < nGroups) || (n >= WFG_CHEF)) && !wfg->node[n].exited;
+}
+
+/**
+ *  \brief Checks if any of the signallers of node n is able to make progress.
+ */
+static bool hasSignaller (const WAIT_FOR_GRAPH *wfg, int nGroups, int n, const bool progress[])
+{
+    unsigned int by = wfg->node[n].signallers;
+    int g;
+
+    if ((by & WFG_BY_CHEF) && progress[WFG_CHEF])
+        return true;
+    if ((by & WFG_BY_WAITER) && progress[WFG_WAITER])
+        return true;
+    if ((by & WFG_BY_RECEPTIONIST) && progress[WFG_RECEPTIONIST])
+        return true;
+    if (by & WFG_BY_HOLDER) {
+        int holder = __atomic_load_n (&wfg->mutexHolder, __ATOMIC_ACQUIRE);
+
+        /* an unknown holder is assumed to be able to release the mutex */
+        if ((holder < 0) || (holder >= WFG_NODES) || progress[holder])
+            return true;
+    }
+    if (by & WFG_BY_GROUPS)
+        for (g = 0; g < nGroups; g++)
+            if (progress[g])
+                return true;
+
+    return false;
+}
+
+/**
+ *  \brief Marks the nodes able to make progress, starting from the running ones.
+ */
+static void propagate (const WAIT_FOR_GRAPH *wfg, int nGroups, bool progress[])
+{
+    bool changed;
+    int n;
+
+    for (n = 0; n < WFG_NODES; n++)
+        progress[n] = isLive (wfg, nGroups, n) &&
+                      (__atomic_load_n (&wfg->node[n].blockedOn, __ATOMIC_ACQUIRE) == 0);
+
+    do {
+        changed = false;
+        for (n = 0; n < WFG_NODES; n++)
+            if (!progress[n] && isLive (wfg, nGroups, n) && hasSignaller (wfg, nGroups, n, progress)) {
+                progress[n] = true;
+                changed = true;
+            }
+    } while (changed);
+}
+
+/* external functions */
+
+/**
+ *  \brief Recording that an entity is about to block on a semaphore.
+ *
+ *  \param wfg pointer to the wait-for graph
+ *  \param nGroups number of groups
+ *  \param self node of the calling entity
+ *  \param sindex semaphore location in the set
+ *  \param signallers classes of entities expected to signal the semaphore
+ *
+ *  \return \c true, if the entity is suspected to be deadlocked
+ *  \return \c false, otherwise
+ */
+bool wfgBlock (WAIT_FOR_GRAPH *wfg, int nGroups, int self, unsigned int sindex, unsigned int signallers)
+{
+    bool progress[WFG_NODES];
+    WFG_NODE *me;
+
+    if ((self < 0) || (self >= WFG_NODES))
+        return false;
+
+    me = &wfg->node[self];
+    me->signallers = signallers;
+    __atomic_fetch_add (&me->generation, 1, __ATOMIC_RELEASE);
+    __atomic_store_n (&me->blockedOn, sindex, __ATOMIC_RELEASE);
+
+    propagate (wfg, nGroups, progress);
+
+    return !progress[self];
+}
+
+/**
+ *  \brief Recording that an entity is no longer blocked.
+ *
+ *  \param wfg pointer to the wait-for graph
+ *  \param self node of the calling entity
+ */
+void wfgUnblock (WAIT_FOR_GRAPH *wfg, int self)
+{
+    if ((self < 0) || (self >= WFG_NODES))
+        return;
+
+    __atomic_store_n (&wfg->node[self].blockedOn, 0, __ATOMIC_RELEASE);
+    __atomic_fetch_add (&wfg->node[self].generation, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ *  \brief Searching for deadlocked entities.
+ *
+ *  \param wfg pointer to the wait-for graph
+ *  \param nGroups number of groups
+ *  \param deadlocked array of <tt>WFG_NODES</tt> flags set for the deadlocked entities (may be NULL)
+ *
+ *  \return number of deadlocked entities
+ */
+int wfgFindDeadlock (const WAIT_FOR_GRAPH *wfg, int nGroups, bool deadlocked[])
+{
+    bool progress[WFG_NODES];
+    int n, nDead = 0;
+
+    propagate (wfg, nGroups, progress);
+    for (n = 0; n < WFG_NODES; n++) {
+        bool dead = isLive (wfg, nGroups, n) && !progress[n];
+
+        if (deadlocked != NULL)
+            deadlocked[n] = dead;
+        if (dead)
+            nDead += 1;
+    }
+
+    return nDead;
+}
+
+/**
+ *  \brief Confirmation of a deadlock against the kernel view of the semaphore set.
+ *
+ *  \param wfg pointer to the wait-for graph
+ *  \param nGroups number of groups
+ *  \param semgid semaphore set identifier
+ *
+ *  \return number of deadlocked entities (0 if the deadlock is not confirmed)
+ */
+int wfgConfirm (const WAIT_FOR_GRAPH *wfg, int nGroups, int semgid)
+{
+    unsigned int generation[WFG_NODES];
+    int n, m, nDead, nWaiting;
+
+    for (n = 0; n < WFG_NODES; n++)
+        generation[n] = __atomic_load_n (&wfg->node[n].generation, __ATOMIC_ACQUIRE);
+
+    if ((nDead = wfgFindDeadlock (wfg, nGroups, NULL)) == 0)
+        return 0;
+
+    for (n = 0; n < WFG_NODES; n++) {
+        unsigned int sindex = __atomic_load_n (&wfg->node[n].blockedOn, __ATOMIC_ACQUIRE);
+
+        if (!isLive (wfg, nGroups, n) || (sindex == 0))
+            continue;
+        for (m = 0, nWaiting = 0; m < WFG_NODES; m++)
+            if (isLive (wfg, nGroups, m) && (wfg->node[m].blockedOn == sindex))
+                nWaiting += 1;
+        if ((semGetValue (semgid, sindex) != 0) || (semGetWaiting (semgid, sindex) < nWaiting))
+            return 0;
+    }
+
+    for (n = 0; n < WFG_NODES; n++)
+        if (__atomic_load_n (&wfg->node[n].generation, __ATOMIC_ACQUIRE) != generation[n])
+            return 0;
+
+    return nDead;
+}
@@ -0,0 +1,128 @@
+/**
+ *  \file waitForGraph.h (interface file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  Online deadlock detection based on a wait-for graph kept in shared memory.
+ *
+ *  Each intervening entity records, before a <em>down</em>, the semaphore it is about to block on and which
+ *  entities are expected to signal it. An entity is able to make progress if it is running or if any of its
+ *  expected signallers is able to make progress; the entities left blocked when this relation stabilizes are
+ *  deadlocked (either they wait for each other or no live entity will ever signal them).
+ *
+ *  Defined operations:
+ *     \li recording that an entity is about to block on a semaphore
+ *     \li recording that an entity is no longer blocked
+ *     \li searching for deadlocked entities
+ *     \li confirmation of a deadlock against the kernel view of the semaphore set.
+ */
+
+#ifndef WAITFORGRAPH_H_
+#define WAITFORGRAPH_H_
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include "probConst.h"
+
+/* wait-for graph nodes: groups take nodes 0 .. MAXGROUPS-1 */
+
+/** \brief node of the chef */
+#define  WFG_CHEF            (MAXGROUPS)
+/** \brief node of the waiter */
+#define  WFG_WAITER          (MAXGROUPS+1)
+/** \brief node of the receptionist */
+#define  WFG_RECEPTIONIST    (MAXGROUPS+2)
+/** \brief number of nodes */
+#define  WFG_NODES           (MAXGROUPS+3)
+
+/* classes of entities expected to signal a semaphore */
+
+/** \brief semaphore is signalled by the chef */
+#define  WFG_BY_CHEF          0x01
+/** \brief semaphore is signalled by the waiter */
+#define  WFG_BY_WAITER        0x02
+/** \brief semaphore is signalled by the receptionist */
+#define  WFG_BY_RECEPTIONIST  0x04
+/** \brief semaphore is signalled by any of the groups */
+#define  WFG_BY_GROUPS        0x08
+/** \brief semaphore is signalled by the entity holding the mutex */
+#define  WFG_BY_HOLDER        0x10
+
+/**
+ *  \brief Definition of a node of the wait-for graph.
+ */
+typedef struct {
+    /** \brief process id of the entity (set by the main process) */
+    pid_t pid;
+    /** \brief entity has terminated (set by the main process) */
+    bool exited;
+    /** \brief semaphore the entity is blocked on (0 if running) */
+    unsigned int blockedOn;
+    /** \brief classes of entities expected to signal <tt>blockedOn</tt> */
+    unsigned int signallers;
+    /** \brief incremented on every block and unblock (used to validate snapshots) */
+    unsigned int generation;
+} WFG_NODE;
+
+/**
+ *  \brief Definition of the wait-for graph.
+ */
+typedef struct {
+    /** \brief nodes of the graph */
+    WFG_NODE node[WFG_NODES];
+    /** \brief node holding the mutex (-1 if unknown) */
+    int mutexHolder;
+} WAIT_FOR_GRAPH;
+
+/**
+ *  \brief Recording that an entity is about to block on a semaphore.
+ *
+ *  The graph is searched from the point of view of the entity: the return value tells if it is left without
+ *  any entity able to signal it, which is the case for the last entity closing a deadlock.
+ *
+ *  \param wfg pointer to the wait-for graph
+ *  \param nGroups number of groups
+ *  \param self node of the calling entity
+ *  \param sindex semaphore location in the set
+ *  \param signallers classes of entities expected to signal the semaphore
+ *
+ *  \return \c true, if the entity is suspected to be deadlocked
+ *  \return \c false, otherwise
+ */
+extern bool wfgBlock (WAIT_FOR_GRAPH *wfg, int nGroups, int self, unsigned int sindex, unsigned int signallers);
+
+/**
+ *  \brief Recording that an entity is no longer blocked.
+ *
+ *  \param wfg pointer to the wait-for graph
+ *  \param self node of the calling entity
+ */
+extern void wfgUnblock (WAIT_FOR_GRAPH *wfg, int self);
+
+/**
+ *  \brief Searching for deadlocked entities.
+ *
+ *  \param wfg pointer to the wait-for graph
+ *  \param nGroups number of groups
+ *  \param deadlocked array of <tt>WFG_NODES</tt> flags set for the deadlocked entities (may be NULL)
+ *
+ *  \return number of deadlocked entities
+ */
+extern int wfgFindDeadlock (const WAIT_FOR_GRAPH *wfg, int nGroups, bool deadlocked[]);
+
+/**
+ *  \brief Confirmation of a deadlock against the kernel view of the semaphore set.
+ *
+ *  Every blocked entity must really be asleep in the kernel: the semaphores they are blocked on are red
+ *  and hold at least as many waiting processes as recorded, and no entity blocked or unblocked meanwhile.
+ *
+ *  \param wfg pointer to the wait-for graph
+ *  \param nGroups number of groups
+ *  \param semgid semaphore set identifier
+ *
+ *  \return number of deadlocked entities (0 if the deadlock is not confirmed)
+ */
+extern int wfgConfirm (const WAIT_FOR_GRAPH *wfg, int nGroups, int semgid);
+
+#endif /* WAITFORGRAPH_H_ */
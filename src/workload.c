@@ -0,0 +1,461 @@
+/**
+ *  \file workload.c (implementation file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  \brief Generation of the arrivals and eating times of the groups.
+ *
+ *  The groups are read from a configuration file, streamed from a text or binary trace, or generated by an
+ *  open loop Poisson or Markov modulated Poisson process (see workload.h for the description of the options).
+ *  The generated times come from a private <tt>erand48</tt> stream, so the sequence of <tt>random</tt> used by
+ *  the simulation does not change. The source is kept open after the groups are loaded, so the arrivals of the
+ *  daemon mode are drawn from where the window of the groups ends.
+ *
+ *  Defined operations:
+ *     \li loading of the workload
+ *     \li initialization of the queue of arrivals of the daemon mode
+ *     \li drawing the next arrivals into the queue.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "workload.h"
+
+/* sources of the workload, in the order of their options */
+#define  SRC_CONFIG     0
+#define  SRC_TRACE      1
+#define  SRC_BIN        2
+#define  SRC_POISSON    3
+#define  SRC_MMPP       4
+
+/** \brief default configuration file */
+#define  CONFIGFILE     "config.txt"
+
+/** \brief size of a record of a binary trace (in bytes) */
+#define  BINRECORD      8
+
+/** \brief state of the source of the workload, kept to draw the arrivals after the window of the groups */
+static struct {
+    int source;                                                                     /* source of the workload */
+    const char *name;                                                                    /* name of the trace */
+    FILE *fp;                                                                         /* trace being streamed */
+    bool binary;                                                                     /* trace is a binary one */
+    char *line;                                                                /* line buffer of a text trace */
+    size_t size;                                                                   /* size of the line buffer */
+    long lineNo;                                                               /* last line read of the trace */
+    long long first;                                              /* arrival of the first group of the window */
+    unsigned short xsubi[3];                                                 /* stream of the generated times */
+    double t, change;                                      /* last generated arrival and next change of state */
+    bool rushing;                                                           /* arrivals of the MMPP in a rush */
+    long gap, rush, dwell, eat;                                          /* parameters of the generated times */
+    int nGroups;                                                          /* groups of the configuration file */
+    int startTime[MAXGROUPS], eatTime[MAXGROUPS];                          /* times of the configuration file */
+    long long period;                                        /* time between rounds of the configuration file */
+    unsigned long next;                                              /* index of the next arrival to be drawn */
+} src;
+
+/**
+ *  \brief Reporting an invalid workload and terminating the process.
+ */
+static void workloadError (const char *where, long line, const char *what)
+{
+    if (line > 0)
+        fprintf (stderr, "%s:%ld: %s\n", where, line, what);
+    else fprintf (stderr, "%s: %s\n", where, what);
+    exit (EXIT_FAILURE);
+}
+
+/**
+ *  \brief Conversion of the value of an option into a non negative number.
+ */
+static long optionValue (const char *name, char *value)
+{
+    char *tinp;
+    long v;
+
+    if (value == NULL)
+        workloadError (name, 0, "workload option needs a value");
+    v = strtol (value, &tinp, 0);
+    if ((*tinp != '\0') || (v < 0) || (v > INT_MAX))
+        workloadError (name, 0, "workload option must be a non negative integer");
+    return v;
+}
+
+/**
+ *  \brief Storing the times of group <tt>g</tt>.
+ */
+static void setGroup (FULL_STAT *p_fSt, int g, long long startTime, long long eatTime, const char *where, long line)
+{
+    if ((startTime < 0) || (startTime > INT_MAX) || (eatTime < 0) || (eatTime > INT_MAX))
+        workloadError (where, line, "time out of range (0 to INT_MAX microseconds)");
+    GROUPSTART (*p_fSt, g) = (int) startTime;
+    GROUPEAT (*p_fSt, g) = (int) eatTime;
+}
+
+/**
+ *  \brief Parsing of the numbers of a line of a text file.
+ *
+ *  The numbers are separated by blanks or a comma; empty lines and lines starting with <tt>#</tt> hold none.
+ *
+ *  \return number of values read (0 for an empty line, -1 for a malformed one)
+ */
+static int parseLine (char *line, long long v[], int max)
+{
+    char *p = line + strspn (line, " \t\r\n"), *rest;
+    int n = 0;
+
+    if ((*p == '\0') || (*p == '#'))
+        return 0;
+    while (*p != '\0') {
+        if (n == max)
+            return -1;
+        v[n++] = strtoll (p, &rest, 10);
+        if (rest == p)
+            return -1;
+        p = rest + strspn (rest, " \t\r\n");
+        if (*p == ',')
+            p += 1 + strspn (p + 1, " \t\r\n");
+    }
+    return n;
+}
+
+/**
+ *  \brief Loading of a configuration file.
+ *
+ *  The first number is the number of groups, followed by one line <tt>startTime eatTime</tt> per group.
+ */
+static void loadConfig (const char *name, int groups, FULL_STAT *p_fSt)
+{
+    FILE *fp;
+    char *line = NULL;
+    size_t size = 0;
+    long lineNo = 0;
+    long long v[2];
+    int n, g = 0;
+
+    if ((fp = fopen (name, "r")) == NULL) {
+        perror ("Could not open config file");
+        exit (EXIT_FAILURE);
+    }
+    p_fSt->nGroups = -1;
+    while (((p_fSt->nGroups == -1) || (g < p_fSt->nGroups)) && (getline (&line, &size, fp) != -1)) {
+        lineNo += 1;
+        if ((n = parseLine (line, v, 2)) == 0)
+            continue;
+        if (p_fSt->nGroups == -1) {
+            if ((n != 1) || (v[0] < 1) || (v[0] > MAXGROUPS))
+                workloadError (name, lineNo, "number of groups must be between 1 and MAXGROUPS");
+            p_fSt->nGroups = (v[0] < groups) ? (int) v[0] : groups;
+        }
+        else if (n != 2)
+            workloadError (name, lineNo, "expected startTime eatTime");
+        else setGroup (p_fSt, g++, v[0], v[1], name, lineNo);
+    }
+    free (line);
+    fclose (fp);
+    if (g < p_fSt->nGroups)
+        workloadError (name, 0, "fewer groups than announced");
+    src.nGroups = p_fSt->nGroups;
+    for (g = 0; g < src.nGroups; g++) {
+        src.startTime[g] = GROUPSTART (*p_fSt, g);
+        src.eatTime[g] = GROUPEAT (*p_fSt, g);
+    }
+}
+
+/**
+ *  \brief Reading the next arrival of the trace.
+ *
+ *  \return \c false at the end of the trace
+ */
+static bool readTrace (const char *name, long long v[2])
+{
+    unsigned char rec[BINRECORD];
+    int i;
+
+    while (true) {
+        if (src.binary) {
+            if (fread (rec, 1, BINRECORD, src.fp) != BINRECORD)
+                break;
+            v[0] = v[1] = 0;
+            for (i = 3; i >= 0; i--) {
+                v[0] = (v[0] << 8) | rec[i];
+                v[1] = (v[1] << 8) | rec[4 + i];
+            }
+            return true;
+        }
+        if (getline (&src.line, &src.size, src.fp) == -1)
+            break;
+        src.lineNo += 1;
+        switch (parseLine (src.line, v, 2)) {
+            case 0:
+                continue;
+            case 2:
+                return true;
+            default:
+                workloadError (name, src.lineNo, "expected arrivalTime,eatTime");
+        }
+    }
+    if (ferror (src.fp)) {
+        perror ("error on reading the trace file");
+        exit (EXIT_FAILURE);
+    }
+    return false;
+}
+
+/**
+ *  \brief Loading of a window of a trace.
+ *
+ *  The trace is streamed: the skipped arrivals are read and discarded (text) or seeked over (binary), and
+ *  reading stops at the last group; the trace is left open for the arrivals of the daemon mode.
+ */
+static void loadTrace (const char *name, bool binary, long skip, int groups, FULL_STAT *p_fSt)
+{
+    long long v[2];
+    int g = 0;
+
+    if ((src.fp = fopen (name, binary ? "rb" : "r")) == NULL) {
+        perror ("Could not open trace file");
+        exit (EXIT_FAILURE);
+    }
+    src.binary = binary;
+    if (binary && (skip > 0) && (fseeko (src.fp, (off_t) skip * BINRECORD, SEEK_SET) == -1)) {
+        perror ("error on seeking the trace file");
+        exit (EXIT_FAILURE);
+    }
+    while ((g < groups) && readTrace (name, v)) {
+        if (!binary && (skip > 0)) {
+            skip -= 1;
+            continue;
+        }
+        if (g == 0)
+            src.first = v[0];
+        if (v[0] < src.first)
+            workloadError (name, binary ? 0 : src.lineNo, "arrival before the first one of the window");
+        setGroup (p_fSt, g++, v[0] - src.first, v[1], name, binary ? 0 : src.lineNo);
+    }
+    if (g == 0)
+        workloadError (name, 0, "no arrivals in the window of the trace");
+    p_fSt->nGroups = g;
+}
+
+/**
+ *  \brief Exponentially distributed time.
+ */
+static double expRand (unsigned short xsubi[3], double mean)
+{
+    return -mean * log (1.0 - erand48 (xsubi));
+}
+
+/**
+ *  \brief Generation of the next arrival.
+ *
+ *  A Markov modulated Poisson process is memoryless, so when a gap crosses a change of state the arrival is
+ *  redrawn from the change with the mean gap of the new state.
+ */
+static void drawArrival (long long *arrival, long long *eatTime)
+{
+    double d;
+
+    while (true) {
+        d = expRand (src.xsubi, src.rushing ? src.rush : src.gap);
+        if (src.t + d <= src.change)
+            break;
+        src.t = src.change;
+        src.rushing = !src.rushing;
+        src.change += expRand (src.xsubi, src.dwell);
+    }
+    src.t += d;
+    *arrival = llround (src.t);
+    *eatTime = llround (expRand (src.xsubi, src.eat));
+}
+
+/**
+ *  \brief Generation of the arrivals of the groups.
+ */
+static void generate (bool bursty, int groups, long gap, long rush, long dwell, long eat, long seed,
+                      FULL_STAT *p_fSt)
+{
+    long long arrival, eatTime;
+    int g;
+
+    src.xsubi[0] = 0x330E;
+    src.xsubi[1] = (unsigned short) seed;
+    src.xsubi[2] = (unsigned short) (seed >> 16);
+    src.t = 0.0;
+    src.change = bursty ? expRand (src.xsubi, dwell) : INFINITY;
+    src.rushing = false;
+    src.gap = gap;
+    src.rush = rush;
+    src.dwell = dwell;
+    src.eat = eat;
+    for (g = 0; g < groups; g++) {
+        drawArrival (&arrival, &eatTime);
+        setGroup (p_fSt, g, arrival, eatTime, bursty ? "mmpp" : "poisson", 0);
+    }
+    p_fSt->nGroups = groups;
+}
+
+/**
+ *  \brief Drawing the arrival that follows the last one drawn.
+ *
+ *  A configuration file is replayed in rounds, each one starting after the latest start time plus the
+ *  longest eating time of the previous one; a trace goes on from the end of the window of the groups.
+ *
+ *  \return \c false if the workload has no more arrivals (end of a trace)
+ */
+static bool drawNext (long long *arrival, long long *eatTime)
+{
+    long long v[2];
+    int g;
+
+    switch (src.source) {
+        case SRC_CONFIG:
+            g = (int) (src.next % src.nGroups);
+            *arrival = (long long) (src.next / src.nGroups) * src.period + src.startTime[g];
+            *eatTime = src.eatTime[g];
+            break;
+        case SRC_TRACE:
+        case SRC_BIN:
+            if (!readTrace (src.name, v))
+                return false;
+            if ((v[0] < src.first) || (v[1] < 0) || (v[1] > INT_MAX))
+                workloadError (src.name, src.binary ? 0 : src.lineNo, "arrival before the first one of the window "
+                                                                      "or eating time out of range");
+            *arrival = v[0] - src.first;
+            *eatTime = v[1];
+            break;
+        default:
+            drawArrival (arrival, eatTime);
+            if (*eatTime > INT_MAX)
+                *eatTime = INT_MAX;
+    }
+    src.next += 1;
+    return true;
+}
+
+/**
+ *  \brief Loading of the workload.
+ *
+ *  The number of groups and their start and eating times are stored in the full state.
+ *
+ *  \param spec description of the workload (<tt>NULL</tt> for <tt>config.txt</tt>); it is modified
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ */
+void workloadLoad (char *spec, FULL_STAT *p_fSt)
+{
+    char *const tokens[] = { "config", "trace", "bin", "poisson", "mmpp",
+                             "groups", "skip", "gap", "rush", "dwell", "eat", "seed", NULL };
+    char *value, *file = CONFIGFILE;
+    int source = SRC_CONFIG, opt, g;
+    long long lastStart = 0, longestEat = 0;
+    long groups = MAXGROUPS, skip = 0, gap = 20000, rush = 2000, dwell = 100000, eat = 100000, seed = getpid ();
+
+    while ((spec != NULL) && (*spec != '\0'))
+        switch (opt = getsubopt (&spec, tokens, &value)) {
+            case SRC_CONFIG:
+            case SRC_TRACE:
+            case SRC_BIN:
+                source = opt;
+                if (value != NULL)
+                    file = value;
+                else if (opt != SRC_CONFIG)
+                    workloadError (tokens[opt], 0, "a trace file must be given");
+                break;
+            case SRC_POISSON:
+            case SRC_MMPP:
+                source = opt;
+                break;
+            case 5: groups = optionValue ("groups", value); break;
+            case 6: skip = optionValue ("skip", value); break;
+            case 7: gap = optionValue ("gap", value); break;
+            case 8: rush = optionValue ("rush", value); break;
+            case 9: dwell = optionValue ("dwell", value); break;
+            case 10: eat = optionValue ("eat", value); break;
+            case 11: seed = optionValue ("seed", value); break;
+            default:
+                workloadError (value, 0, "unknown workload option (config, trace, bin, poisson, mmpp, groups, "
+                                         "skip, gap, rush, dwell, eat or seed)");
+        }
+    if ((groups < 1) || (groups > MAXGROUPS))
+        workloadError ("groups", 0, "number of groups must be between 1 and MAXGROUPS");
+    if ((gap == 0) || (rush == 0) || (dwell == 0) || (eat == 0))
+        workloadError ("workload", 0, "gap, rush, dwell and eat must be positive");
+
+    switch (source) {
+        case SRC_CONFIG:
+            loadConfig (file, (int) groups, p_fSt);
+            break;
+        case SRC_TRACE:
+        case SRC_BIN:
+            loadTrace (file, source == SRC_BIN, skip, (int) groups, p_fSt);
+            break;
+        default:
+            generate (source == SRC_MMPP, (int) groups, gap, rush, dwell, eat, seed, p_fSt);
+    }
+    src.source = source;
+    src.name = file;
+    src.next = (unsigned long) p_fSt->nGroups;
+    if (source == SRC_CONFIG)
+        for (g = 0; g < src.nGroups; g++) {
+            if (src.startTime[g] > lastStart)
+                lastStart = src.startTime[g];
+            if (src.eatTime[g] > longestEat)
+                longestEat = src.eatTime[g];
+        }
+    src.period = lastStart + longestEat;
+}
+
+/**
+ *  \brief Initialization of the queue of arrivals of the daemon mode.
+ *
+ *  The queue is emptied and filled with the arrivals that follow the groups.
+ *
+ *  \param q pointer to the queue
+ */
+void workloadQueueInit (ARRIVAL_QUEUE *q)
+{
+    unsigned long i;
+
+    for (i = 0; i < ARRIVALQUEUE; i++)
+        q->slot[i].seq = i;
+    q->next = q->drawn = 0;
+    q->end = false;
+    workloadFill (q);
+}
+
+/**
+ *  \brief Drawing the next arrivals into the queue of the daemon mode.
+ *
+ *  Every slot already taken by a group is filled; once the workload has no more arrivals, <tt>end</tt> is set.
+ *
+ *  \param q pointer to the queue
+ */
+void workloadFill (ARRIVAL_QUEUE *q)
+{
+    ARRIVAL *a;
+    long long arrival, eatTime;
+
+    while (!q->end) {
+        a = &q->slot[q->drawn % ARRIVALQUEUE];
+        if (__atomic_load_n (&a->seq, __ATOMIC_ACQUIRE) != q->drawn)
+            return;
+        if (!drawNext (&arrival, &eatTime)) {
+            __atomic_store_n (&q->end, true, __ATOMIC_RELEASE);
+            return;
+        }
+        a->time = arrival;
+        a->eatTime = (int) eatTime;
+        __atomic_store_n (&a->seq, q->drawn + 1, __ATOMIC_RELEASE);
+        __atomic_store_n (&q->drawn, q->drawn + 1, __ATOMIC_RELEASE);
+    }
+}
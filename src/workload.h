@@ -0,0 +1,109 @@
+/**
+ *  \file workload.h (interface file)
+ *
+ *  \brief Problem name: Restaurant
+ *
+ *  \brief Generation of the arrivals and eating times of the groups.
+ *
+ *  The workload is described by a comma separated list of options (see <tt>getsubopt</tt>), its source
+ *  followed by its parameters:
+ *     \li <tt>config[=file]</tt>: number of groups and pairs <tt>startTime eatTime</tt> in the format of
+ *         <tt>config.txt</tt> (the default source and file)
+ *     \li <tt>trace=file</tt>: text trace, one arrival per line, <tt>arrivalTime,eatTime</tt> (or separated by
+ *         blanks); empty lines and lines starting with <tt>#</tt> are ignored
+ *     \li <tt>bin=file</tt>: binary trace, one arrival per record of two little endian 32 bit unsigned
+ *         integers, <tt>arrivalTime</tt> and <tt>eatTime</tt>
+ *     \li <tt>poisson</tt>: open loop Poisson arrivals, exponential gaps of mean <tt>gap</tt>
+ *     \li <tt>mmpp</tt>: bursty arrivals, a two state Markov modulated Poisson process whose mean gap is
+ *         <tt>gap</tt> when calm and <tt>rush</tt> during a rush, each state lasting an exponential time of mean
+ *         <tt>dwell</tt>
+ *     \li <tt>groups=n</tt>: number of groups (at most <tt>MAXGROUPS</tt>, the default for the other sources)
+ *     \li <tt>skip=n</tt>: arrivals of a trace skipped before the first group, so any window of a long trace can
+ *         be replayed (traces are streamed, only the arrivals of the groups are read)
+ *     \li <tt>gap=t</tt>, <tt>rush=t</tt>, <tt>dwell=t</tt>, <tt>eat=t</tt>: parameters of the generated
+ *         arrivals; the eating times are exponential of mean <tt>eat</tt>
+ *     \li <tt>seed=n</tt>: seed of the generated arrivals (the process id by default).
+ *
+ *  All times are in microseconds. The arrival times of a trace are taken relative to the first arrival read.
+ *  Any invalid option or entry is reported on stderr and terminates the process.
+ *
+ *  In daemon mode the visits of the groups after their first one are drawn by the main process from the same
+ *  source, into a queue in the shared region from which the groups take them in turn: the next records of a
+ *  trace (the run ends with the trace), more generated arrivals or the next rounds of a configuration file.
+ *
+ *  Defined operations:
+ *     \li loading of the workload
+ *     \li initialization of the queue of arrivals of the daemon mode
+ *     \li drawing the next arrivals into the queue.
+ */
+
+#ifndef WORKLOAD_H_
+#define WORKLOAD_H_
+
+#include <stdbool.h>
+#include <time.h>
+
+#include "probDataStruct.h"
+
+/** \brief number of arrivals of the daemon mode drawn ahead of the groups */
+#define  ARRIVALQUEUE   256
+
+/**
+ *  \brief Definition of an arrival of the daemon mode.
+ */
+typedef struct {
+    /** \brief number of the arrival plus one once it is drawn, plus <tt>ARRIVALQUEUE</tt> once it is taken */
+    unsigned long seq;
+    /** \brief arrival time (in microseconds since the start of the simulation) */
+    long long time;
+    /** \brief eating time (in microseconds) */
+    int eatTime;
+} ARRIVAL;
+
+/**
+ *  \brief Definition of the queue of arrivals of the daemon mode.
+ *
+ *  Arrivals are drawn by the main process only and each one is taken by the group holding its number.
+ */
+typedef struct {
+    /** \brief start of the simulation (<tt>CLOCK_MONOTONIC</tt>), the origin of the arrival times */
+    struct timespec start;
+    /** \brief number of the next arrival to be taken by a group */
+    unsigned long next;
+    /** \brief number of arrivals drawn */
+    unsigned long drawn;
+    /** \brief if the workload has no more arrivals */
+    bool end;
+    /** \brief arrivals, slot <tt>n % ARRIVALQUEUE</tt> holding arrival <tt>n</tt> */
+    ARRIVAL slot[ARRIVALQUEUE];
+} ARRIVAL_QUEUE;
+
+/**
+ *  \brief Loading of the workload.
+ *
+ *  The number of groups and their start and eating times are stored in the full state.
+ *
+ *  \param spec description of the workload (<tt>NULL</tt> for <tt>config.txt</tt>); it is modified
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ */
+extern void workloadLoad (char *spec, FULL_STAT *p_fSt);
+
+/**
+ *  \brief Initialization of the queue of arrivals of the daemon mode.
+ *
+ *  The queue is emptied and filled with the arrivals that follow the groups.
+ *
+ *  \param q pointer to the queue
+ */
+extern void workloadQueueInit (ARRIVAL_QUEUE *q);
+
+/**
+ *  \brief Drawing the next arrivals into the queue of the daemon mode.
+ *
+ *  Every slot already taken by a group is filled; once the workload has no more arrivals, <tt>end</tt> is set.
+ *
+ *  \param q pointer to the queue
+ */
+extern void workloadFill (ARRIVAL_QUEUE *q);
+
+#endif /* WORKLOAD_H_ */